@@ -38,6 +38,26 @@
 #include <concepts>
 #endif
 
+// Lanes used by the batched float noise, 1 means the batches fall back to the single sample functions
+#ifndef SIVPERLIN_SIMD_WIDTH
+#if defined(__AVX2__)
+#define SIVPERLIN_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#define SIVPERLIN_SIMD_WIDTH 4
+#else
+#define SIVPERLIN_SIMD_WIDTH 1
+#endif
+#endif
+
+#if SIVPERLIN_SIMD_WIDTH == 8
+#include <immintrin.h>
+#elif SIVPERLIN_SIMD_WIDTH == 4
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#endif
+
 // Library major version
 #define SIVPERLIN_VERSION_MAJOR 3
 
@@ -206,6 +226,23 @@ class BasicPerlinNoise {
 
     [[nodiscard]] value_type normalizedOctave3D_01(value_type x, value_type y, value_type z, std::int32_t octaves, value_type persistence = value_type(0.5)) const noexcept;
 
+    ///////////////////////////////////////
+    //
+    //	Batched 2D noise (out[i] is the single sample result at (x[i], y[i]))
+    //	Float noise runs SIVPERLIN_SIMD_WIDTH samples at a time with the same operations as the single sample
+    //	functions, so the results are identical unless the compiler contracts those into fused multiply-adds
+    //
+
+    void noise2DBatch(const value_type *x, const value_type *y, value_type *out, std::size_t count) const noexcept;
+
+    void octave2DBatch(const value_type *x, const value_type *y, value_type *out, std::size_t count, std::int32_t octaves, value_type persistence = value_type(0.5)) const noexcept;
+
+    void octave2DBatch(const value_type *x, const value_type *y, value_type *out, std::size_t count, std::int32_t octaves, const value_type *persistence) const noexcept;
+
+    void octave2D_11Batch(const value_type *x, const value_type *y, value_type *out, std::size_t count, std::int32_t octaves, value_type persistence = value_type(0.5)) const noexcept;
+
+    void octave2D_11Batch(const value_type *x, const value_type *y, value_type *out, std::size_t count, std::int32_t octaves, const value_type *persistence) const noexcept;
+
   private:
     state_type m_permutation;
 };
@@ -327,6 +364,222 @@ template <class Noise, class Float>
     return result;
 }
 
+////////////////////////////////////////////////
+//
+//	Batched float noise
+//
+#if SIVPERLIN_SIMD_WIDTH == 8
+struct FloatLanes {
+    using reg = __m256;
+    using ireg = __m256i;
+    static constexpr std::size_t width = 8;
+
+    static reg load(const float *p) noexcept { return _mm256_loadu_ps(p); }
+    static void store(float *p, const reg v) noexcept { _mm256_storeu_ps(p, v); }
+    static reg set1(const float v) noexcept { return _mm256_set1_ps(v); }
+    static reg add(const reg a, const reg b) noexcept { return _mm256_add_ps(a, b); }
+    static reg sub(const reg a, const reg b) noexcept { return _mm256_sub_ps(a, b); }
+    static reg mul(const reg a, const reg b) noexcept { return _mm256_mul_ps(a, b); }
+    static reg clamp(const reg v, const reg lo, const reg hi) noexcept { return _mm256_min_ps(_mm256_max_ps(v, lo), hi); }
+    static reg floor(const reg v) noexcept { return _mm256_floor_ps(v); }
+    static ireg truncate(const reg v) noexcept { return _mm256_cvttps_epi32(v); }
+    static void storeInt(std::int32_t *p, const ireg v) noexcept { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+    static ireg loadInt(const std::int32_t *p) noexcept { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+    static ireg set1Int(const std::int32_t v) noexcept { return _mm256_set1_epi32(v); }
+    static ireg andInt(const ireg a, const ireg b) noexcept { return _mm256_and_si256(a, b); }
+    static ireg orInt(const ireg a, const ireg b) noexcept { return _mm256_or_si256(a, b); }
+    static ireg equal(const ireg a, const ireg b) noexcept { return _mm256_cmpeq_epi32(a, b); }
+    static ireg less(const ireg a, const ireg b) noexcept { return _mm256_cmpgt_epi32(b, a); }
+    template <int Bits>
+    static ireg shiftLeft(const ireg v) noexcept { return _mm256_slli_epi32(v, Bits); }
+    // mask ? a : b
+    static reg select(const ireg mask, const reg a, const reg b) noexcept { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask)); }
+    static reg flipSign(const reg v, const ireg sign) noexcept { return _mm256_xor_ps(v, _mm256_castsi256_ps(sign)); }
+};
+#elif SIVPERLIN_SIMD_WIDTH == 4
+struct FloatLanes {
+    using reg = __m128;
+    using ireg = __m128i;
+    static constexpr std::size_t width = 4;
+
+    static reg load(const float *p) noexcept { return _mm_loadu_ps(p); }
+    static void store(float *p, const reg v) noexcept { _mm_storeu_ps(p, v); }
+    static reg set1(const float v) noexcept { return _mm_set1_ps(v); }
+    static reg add(const reg a, const reg b) noexcept { return _mm_add_ps(a, b); }
+    static reg sub(const reg a, const reg b) noexcept { return _mm_sub_ps(a, b); }
+    static reg mul(const reg a, const reg b) noexcept { return _mm_mul_ps(a, b); }
+    static reg clamp(const reg v, const reg lo, const reg hi) noexcept { return _mm_min_ps(_mm_max_ps(v, lo), hi); }
+#if defined(__SSE4_1__)
+    static reg floor(const reg v) noexcept { return _mm_floor_ps(v); }
+#else
+    // truncate, then step down where that rounded up
+    static reg floor(const reg v) noexcept {
+        const reg t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+    }
+#endif
+    static ireg truncate(const reg v) noexcept { return _mm_cvttps_epi32(v); }
+    static void storeInt(std::int32_t *p, const ireg v) noexcept { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+    static ireg loadInt(const std::int32_t *p) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+    static ireg set1Int(const std::int32_t v) noexcept { return _mm_set1_epi32(v); }
+    static ireg andInt(const ireg a, const ireg b) noexcept { return _mm_and_si128(a, b); }
+    static ireg orInt(const ireg a, const ireg b) noexcept { return _mm_or_si128(a, b); }
+    static ireg equal(const ireg a, const ireg b) noexcept { return _mm_cmpeq_epi32(a, b); }
+    static ireg less(const ireg a, const ireg b) noexcept { return _mm_cmplt_epi32(a, b); }
+    template <int Bits>
+    static ireg shiftLeft(const ireg v) noexcept { return _mm_slli_epi32(v, Bits); }
+    // mask ? a : b
+    static reg select(const ireg mask, const reg a, const reg b) noexcept {
+        const reg m = _mm_castsi128_ps(mask);
+        return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+    }
+    static reg flipSign(const reg v, const ireg sign) noexcept { return _mm_xor_ps(v, _mm_castsi128_ps(sign)); }
+};
+#endif
+
+#if SIVPERLIN_SIMD_WIDTH > 1
+template <class Lanes>
+[[nodiscard]] inline typename Lanes::reg FadeLanes(const typename Lanes::reg t) noexcept {
+    using L = Lanes;
+    const auto inner = L::add(L::mul(t, L::sub(L::mul(t, L::set1(6.0f)), L::set1(15.0f))), L::set1(10.0f));
+    return L::mul(L::mul(L::mul(t, t), t), inner);
+}
+
+template <class Lanes>
+[[nodiscard]] inline typename Lanes::reg LerpLanes(const typename Lanes::reg a, const typename Lanes::reg b, const typename Lanes::reg t) noexcept {
+    using L = Lanes;
+    return L::add(a, L::mul(L::sub(b, a), t));
+}
+
+// Grad() with the branches turned into selects, negating is flipping the sign bit
+template <class Lanes>
+[[nodiscard]] inline typename Lanes::reg GradLanes(const typename Lanes::ireg h, const typename Lanes::reg x, const typename Lanes::reg y, const typename Lanes::reg z) noexcept {
+    using L = Lanes;
+    const auto u = L::select(L::less(h, L::set1Int(8)), x, y);
+    const auto x_or_z = L::select(L::orInt(L::equal(h, L::set1Int(12)), L::equal(h, L::set1Int(14))), x, z);
+    const auto v = L::select(L::less(h, L::set1Int(4)), y, x_or_z);
+    const auto u_sign = L::template shiftLeft<31>(L::andInt(h, L::set1Int(1)));
+    const auto v_sign = L::template shiftLeft<30>(L::andInt(h, L::set1Int(2)));
+    return L::add(L::flipSign(u, u_sign), L::flipSign(v, v_sign));
+}
+
+// noise3D() at Lanes::width points sharing z
+template <class Lanes>
+[[nodiscard]] inline typename Lanes::reg Noise3DLanes(const std::array<std::uint8_t, 256> &p, const typename Lanes::reg x, const typename Lanes::reg y, const float z) noexcept {
+    using L = Lanes;
+    constexpr std::size_t W = L::width;
+    const auto _x = L::floor(x);
+    const auto _y = L::floor(y);
+    const float _z = std::floor(z);
+
+    // the permutation lookups have no vector form below AVX-512, they run one lane at a time
+    std::int32_t ix[W], iy[W], hashes[8][W];
+    L::storeInt(ix, L::truncate(_x));
+    L::storeInt(iy, L::truncate(_y));
+    const std::int32_t iz = static_cast<std::int32_t>(_z) & 255;
+    for (std::size_t i = 0; i < W; ++i) {
+        const std::int32_t lx = ix[i] & 255;
+        const std::int32_t ly = iy[i] & 255;
+        const std::uint8_t A = (p[lx] + ly) & 255;
+        const std::uint8_t B = (p[(lx + 1) & 255] + ly) & 255;
+        const std::uint8_t AA = (p[A] + iz) & 255;
+        const std::uint8_t AB = (p[(A + 1) & 255] + iz) & 255;
+        const std::uint8_t BA = (p[B] + iz) & 255;
+        const std::uint8_t BB = (p[(B + 1) & 255] + iz) & 255;
+        hashes[0][i] = p[AA] & 15;
+        hashes[1][i] = p[BA] & 15;
+        hashes[2][i] = p[AB] & 15;
+        hashes[3][i] = p[BB] & 15;
+        hashes[4][i] = p[(AA + 1) & 255] & 15;
+        hashes[5][i] = p[(BA + 1) & 255] & 15;
+        hashes[6][i] = p[(AB + 1) & 255] & 15;
+        hashes[7][i] = p[(BB + 1) & 255] & 15;
+    }
+
+    const auto one = L::set1(1.0f);
+    const auto fx = L::sub(x, _x);
+    const auto fy = L::sub(y, _y);
+    const auto fz = L::set1(z - _z);
+    const auto fx1 = L::sub(fx, one);
+    const auto fy1 = L::sub(fy, one);
+    const auto fz1 = L::set1((z - _z) - 1);
+
+    const auto u = FadeLanes<L>(fx);
+    const auto v = FadeLanes<L>(fy);
+    const auto w = L::set1(Fade(z - _z));
+
+    const auto p0 = GradLanes<L>(L::loadInt(hashes[0]), fx, fy, fz);
+    const auto p1 = GradLanes<L>(L::loadInt(hashes[1]), fx1, fy, fz);
+    const auto p2 = GradLanes<L>(L::loadInt(hashes[2]), fx, fy1, fz);
+    const auto p3 = GradLanes<L>(L::loadInt(hashes[3]), fx1, fy1, fz);
+    const auto p4 = GradLanes<L>(L::loadInt(hashes[4]), fx, fy, fz1);
+    const auto p5 = GradLanes<L>(L::loadInt(hashes[5]), fx1, fy, fz1);
+    const auto p6 = GradLanes<L>(L::loadInt(hashes[6]), fx, fy1, fz1);
+    const auto p7 = GradLanes<L>(L::loadInt(hashes[7]), fx1, fy1, fz1);
+
+    const auto q0 = LerpLanes<L>(p0, p1, u);
+    const auto q1 = LerpLanes<L>(p2, p3, u);
+    const auto q2 = LerpLanes<L>(p4, p5, u);
+    const auto q3 = LerpLanes<L>(p6, p7, u);
+
+    const auto r0 = LerpLanes<L>(q0, q1, v);
+    const auto r1 = LerpLanes<L>(q2, q3, v);
+
+    return LerpLanes<L>(r0, r1, w);
+}
+#endif
+
+// Octave2D() over count points, persistence is either one value for every point or one per point
+template <class Noise, class Float>
+inline void Octave2DBatch(const Noise &noise, const Float *x, const Float *y, Float *out, const std::size_t count, const std::int32_t octaves, const Float *persistence, const bool per_point, const bool clamp) noexcept {
+#if SIVPERLIN_SIMD_WIDTH > 1
+    if constexpr (std::is_same_v<Float, float>) {
+        using L = FloatLanes;
+        const float z = static_cast<float>(SIVPERLIN_DEFAULT_Z);
+        const auto lanes = [&](const float *lx_in, const float *ly_in, const float *lp_in, float *lout) {
+            auto lx = L::load(lx_in);
+            auto ly = L::load(ly_in);
+            const auto lp = per_point ? L::load(lp_in) : L::set1(*persistence);
+            auto result = L::set1(0.0f);
+            auto amplitude = L::set1(1.0f);
+            for (std::int32_t o = 0; o < octaves; ++o) {
+                result = L::add(result, L::mul(Noise3DLanes<L>(noise.serialize(), lx, ly, z), amplitude));
+                lx = L::mul(lx, L::set1(2.0f));
+                ly = L::mul(ly, L::set1(2.0f));
+                amplitude = L::mul(amplitude, lp);
+            }
+            if (clamp) {
+                result = L::clamp(result, L::set1(-1.0f), L::set1(1.0f));
+            }
+            L::store(lout, result);
+        };
+        std::size_t i = 0;
+        for (; i + L::width <= count; i += L::width) {
+            lanes(x + i, y + i, persistence + (per_point ? i : 0), out + i);
+        }
+        // pad the last few points out to a full set of lanes
+        if (i < count) {
+            float tx[L::width] = {}, ty[L::width] = {}, tp[L::width] = {}, tout[L::width];
+            const std::size_t rest = count - i;
+            std::copy_n(x + i, rest, tx);
+            std::copy_n(y + i, rest, ty);
+            if (per_point) {
+                std::copy_n(persistence + i, rest, tp);
+            }
+            lanes(tx, ty, tp, tout);
+            std::copy_n(tout, rest, out + i);
+        }
+        return;
+    }
+#endif
+    for (std::size_t i = 0; i < count; ++i) {
+        const Float p = per_point ? persistence[i] : *persistence;
+        out[i] = clamp ? noise.octave2D_11(x[i], y[i], octaves, p) : noise.octave2D(x[i], y[i], octaves, p);
+    }
+}
+//
+////////////////////////////////////////////////
+
 template <class Float>
 [[nodiscard]] inline constexpr Float MaxAmplitude(const std::int32_t octaves, const Float persistence) noexcept {
     using value_type = Float;
@@ -560,6 +813,34 @@ template <class Float>
 inline typename BasicPerlinNoise<Float>::value_type BasicPerlinNoise<Float>::normalizedOctave3D_01(const value_type x, const value_type y, const value_type z, const std::int32_t octaves, const value_type persistence) const noexcept {
     return perlin_detail::Remap_01(normalizedOctave3D(x, y, z, octaves, persistence));
 }
+///////////////////////////////////////
+
+template <class Float>
+inline void BasicPerlinNoise<Float>::noise2DBatch(const value_type *x, const value_type *y, value_type *out, const std::size_t count) const noexcept {
+    // one octave at full amplitude is a single sample
+    const value_type persistence = 1;
+    perlin_detail::Octave2DBatch(*this, x, y, out, count, 1, &persistence, false, false);
+}
+
+template <class Float>
+inline void BasicPerlinNoise<Float>::octave2DBatch(const value_type *x, const value_type *y, value_type *out, const std::size_t count, const std::int32_t octaves, const value_type persistence) const noexcept {
+    perlin_detail::Octave2DBatch(*this, x, y, out, count, octaves, &persistence, false, false);
+}
+
+template <class Float>
+inline void BasicPerlinNoise<Float>::octave2DBatch(const value_type *x, const value_type *y, value_type *out, const std::size_t count, const std::int32_t octaves, const value_type *persistence) const noexcept {
+    perlin_detail::Octave2DBatch(*this, x, y, out, count, octaves, persistence, true, false);
+}
+
+template <class Float>
+inline void BasicPerlinNoise<Float>::octave2D_11Batch(const value_type *x, const value_type *y, value_type *out, const std::size_t count, const std::int32_t octaves, const value_type persistence) const noexcept {
+    perlin_detail::Octave2DBatch(*this, x, y, out, count, octaves, &persistence, false, true);
+}
+
+template <class Float>
+inline void BasicPerlinNoise<Float>::octave2D_11Batch(const value_type *x, const value_type *y, value_type *out, const std::size_t count, const std::int32_t octaves, const value_type *persistence) const noexcept {
+    perlin_detail::Octave2DBatch(*this, x, y, out, count, octaves, persistence, true, true);
+}
 } // namespace siv
 
 #undef SIVPERLIN_NODISCARD_CXX20
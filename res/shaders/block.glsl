@@ -1,59 +1,125 @@
 #shader vertex
 #version 450
 
-layout(location=0) in int a_data;
-       
+layout(location=0) in int a_position;
+layout(location=1) in int a_data;
+
 layout(location=0) out vec3 v_pos;
-layout(location=1) out vec2 v_tex_coords;
+layout(location=1) out vec2 v_uv;
 layout(location=2) out vec3 v_normal;
+layout(location=3) flat out int v_tile;
+layout(location=4) flat out int v_orientation;
+layout(location=5) out float v_ao;
 
 uniform mat4 u_projection;
 uniform mat4 u_view;
 
 uniform vec3 u_chunk_offset;
 uniform vec3 u_chunk_size;
+// blocks per cube of the chunk's mesh, see Chunk::set_lod
+uniform float u_lod_scale;
+
+// corners of a unit cube
+const vec3 cube_corners[8] = vec3[8](
+    vec3(0.0, 0.0, 0.0), vec3(1.0, 0.0, 0.0),
+    vec3(1.0, 1.0, 0.0), vec3(0.0, 1.0, 0.0),
+    vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 1.0),
+    vec3(1.0, 1.0, 1.0), vec3(0.0, 1.0, 1.0)
+);
+// bottom left, bottom right, top right and top left corner of each face
+const int face_corners[24] = int[24](
+    0, 4, 7, 3, // left
+    5, 1, 2, 6, // right
+    4, 5, 6, 7, // forward
+    0, 1, 2, 3, // backward
+    7, 6, 2, 3, // top
+    4, 5, 1, 0  // bottom
+);
+// axes the quad's width and height run along
+const ivec2 face_axes[6] = ivec2[6](
+    ivec2(2, 1), ivec2(2, 1), ivec2(0, 1), ivec2(0, 1), ivec2(0, 2), ivec2(0, 2)
+);
+// two triangles, bl -> br -> tr and tr -> tl -> bl
+const int triangle_corners[6] = int[6](0, 1, 2, 2, 3, 0);
+// the same quad split along its other diagonal
+const int flipped_corners[6] = int[6](1, 2, 3, 3, 0, 1);
+// light left at each level of baked ambient occlusion
+const float ao_light[4] = float[4](1.0, 0.8, 0.6, 0.4);
+
+// occlusion of one of the quad's corners, see Chunk::face_ao
+int corner_ao(int normal_idx, int corner) {
+    ivec2 uv = ivec2(cube_corners[corner][face_axes[normal_idx].x],
+                     cube_corners[corner][face_axes[normal_idx].y]);
+    return (a_data >> (24 + 2 * (uv.x + 2 * uv.y))) & 0x3;
+}
 
 void main() {
+    int normal_idx = a_data & 0x7;
+    // padding left after a section's quads, put every corner on the same
+    // point so nothing gets drawn
+    if (normal_idx > 5) {
+        gl_Position = vec4(0.0);
+        return;
+    }
+    // every vertex of the quad's instance gets the same record, pick the
+    // corner from the vertex id
+    vec3 size = vec3(1.0);
+    size[face_axes[normal_idx].x] = float(((a_data >> 5) & 0xF) + 1);
+    size[face_axes[normal_idx].y] = float(((a_data >> 9) & 0xF) + 1);
+    // split the quad along the diagonal with more occlusion so the shading
+    // stays symmetric
+    int ao[4];
+    for (int i = 0; i < 4; ++i) {
+        ao[i] = corner_ao(normal_idx, face_corners[normal_idx * 4 + i]);
+    }
+    int slot = ao[1] + ao[3] > ao[0] + ao[2] ? flipped_corners[gl_VertexID]
+                                             : triangle_corners[gl_VertexID];
+    int corner = face_corners[normal_idx * 4 + slot];
+    v_ao = ao_light[ao[slot]];
+
     // compute world offset
-    vec3 pos = vec3(
-        float((a_data & 0xF) >> 0),
-        float((a_data & 0xFF0) >> 4),
-        float((a_data & 0xF000) >> 12)
+    vec3 local = vec3(
+        float((a_position >> 0) & 0x3FF),
+        float((a_position >> 10) & 0xFFF),
+        float((a_position >> 22) & 0x3FF)
     );
-    pos += u_chunk_offset * u_chunk_size;
+    local += cube_corners[corner] * size;
+    // cubes on the far edges of a coarse mesh stick out of the chunk
+    local = min(local * u_lod_scale, u_chunk_size);
+    vec3 pos = local + u_chunk_offset * u_chunk_size;
     v_pos = pos;
 
     gl_Position = u_projection * u_view * vec4(pos, 1.0);
 
     // set varyings
-    v_tex_coords = vec2(
-        float((a_data & 0x380000) >> 19),
-        float((a_data & 0x1C00000) >> 22)
-    );
-    v_tex_coords /= 4.0;
+    v_tile = (a_data >> 13) & 0x7FF;
+    v_orientation = (a_data >> 3) & 0x3;
 
     // compute normal
-    int normal_idx = int(
-        (a_data & 0x70000) >> 16
-    );
     if (normal_idx == 0) {
         // left
         v_normal = vec3(-1.0, 0.0, 0.0);
+        v_uv = vec2(local.z, local.y);
     } else if (normal_idx == 1) {
         // right
         v_normal = vec3(1.0, 0.0, 0.0);
+        v_uv = vec2(-local.z, local.y);
     } else if (normal_idx == 2) {
         // forward
         v_normal = vec3(0.0, 0.0, 1.0);
+        v_uv = vec2(local.x, local.y);
     } else if (normal_idx == 3) {
         // backward
         v_normal = vec3(0.0, 0.0, -1.0);
+        v_uv = vec2(local.x, local.y);
     } else if (normal_idx == 4) {
         // top
         v_normal = vec3(0.0, 1.0, 0.0);
+        v_uv = vec2(local.x, -local.z);
     } else if (normal_idx == 5) {
         // bottom
         v_normal = vec3(0.0, -1.0, 0.0);
+        v_uv = vec2(local.x, -local.z);
     }
 }
 
@@ -61,21 +127,43 @@ void main() {
 #version 450
 
 layout(location=0) in vec3 v_pos;
-layout(location=1) in vec2 v_tex_coords;
+layout(location=1) in vec2 v_uv;
 layout(location=2) in vec3 v_normal;
+layout(location=3) flat in int v_tile;
+layout(location=4) flat in int v_orientation;
+layout(location=5) in float v_ao;
 
 layout(location=0) out vec4 position;
 layout(location=1) out vec3 normal;
 layout(location=2) out vec4 color;
 
 uniform sampler2D u_texture;
+// tiles per row of the block atlas
+uniform int u_atlas_size;
 
 void main() {
-    vec4 tex_color = texture(u_texture, v_tex_coords);
+    // v_uv is in blocks so the tile repeats across merged faces
+    vec2 uv = fract(v_uv);
+    // rotate a quarter turn at a time
+    for (int i = 0; i < v_orientation; ++i) {
+        uv = vec2(1.0 - uv.y, uv.x);
+    }
+    vec2 tile = vec2(v_tile % u_atlas_size, v_tile / u_atlas_size);
+    vec2 tex_coords = (tile + uv) / float(u_atlas_size);
+    // take the gradients from the unwrapped uv so the seams between blocks
+    // don't pick the wrong mip level
+    vec2 scale = vec2(1.0 / float(u_atlas_size));
+    vec4 tex_color = textureGrad(
+        u_texture, tex_coords, dFdx(v_uv) * scale, dFdy(v_uv) * scale);
+    // see-through parts of transparent blocks
+    if (tex_color.a < 0.5) {
+        discard;
+    }
 
     // MAKE w=1.0 OR ELSE SHADOWS DON'T WORK
     position = vec4(v_pos, 1.0);
     normal = v_normal;
     color.rgb = tex_color.rgb;
-    color.a = 1.0;
+    // baked ambient occlusion, applied to the ambient light in composite
+    color.a = v_ao;
 }
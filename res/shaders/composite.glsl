@@ -23,6 +23,8 @@ uniform sampler2D u_depth_map;
 uniform mat4 u_light_space;
 
 uniform sampler2D u_ssao;
+// the SSAO pass can be turned off, the baked occlusion is always there
+uniform bool u_ssao_enabled;
 
 out vec4 color;
 
@@ -121,9 +123,11 @@ vec3 get_sunlight(vec3 position, vec3 normal) {
     vec3 light_dir = normalize(u_sunlight.direction);
     float cos_theta = dot(normal, -light_dir);
 
-    // ambient
-    float ao = texture(u_ssao, v_tex_coords).r;
-    ao = clamp(ao, 0.5, 1.0);
+    // ambient, the mesh's baked occlusion is in the color's alpha
+    float ao = texture(u_color, v_tex_coords).a;
+    if (u_ssao_enabled) {
+        ao *= clamp(texture(u_ssao, v_tex_coords).r, 0.5, 1.0);
+    }
     vec3 ambient = u_sunlight.ambient * ao;
     // diffuse
     vec3 diffuse = max(cos_theta, 0.0) * u_sunlight.diffuse;
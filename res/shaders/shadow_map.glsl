@@ -1,20 +1,56 @@
 #shader vertex
 #version 450
 
-layout(location=0) in int a_data;
-       
+layout(location=0) in int a_position;
+layout(location=1) in int a_data;
+
 uniform mat4 u_light_space;
 
 uniform vec3 u_chunk_offset;
 uniform vec3 u_chunk_size;
+uniform float u_lod_scale;
+
+// see block.glsl, quads are expanded the same way
+const vec3 cube_corners[8] = vec3[8](
+    vec3(0.0, 0.0, 0.0), vec3(1.0, 0.0, 0.0),
+    vec3(1.0, 1.0, 0.0), vec3(0.0, 1.0, 0.0),
+    vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 1.0),
+    vec3(1.0, 1.0, 1.0), vec3(0.0, 1.0, 1.0)
+);
+const int face_corners[24] = int[24](
+    0, 4, 7, 3, // left
+    5, 1, 2, 6, // right
+    4, 5, 6, 7, // forward
+    0, 1, 2, 3, // backward
+    7, 6, 2, 3, // top
+    4, 5, 1, 0  // bottom
+);
+const ivec2 face_axes[6] = ivec2[6](
+    ivec2(2, 1), ivec2(2, 1), ivec2(0, 1), ivec2(0, 1), ivec2(0, 2), ivec2(0, 2)
+);
+const int triangle_corners[6] = int[6](0, 1, 2, 2, 3, 0);
 
 void main() {
+    int normal_idx = a_data & 0x7;
+    // padding left after a section's quads, put every corner on the same
+    // point so nothing gets drawn
+    if (normal_idx > 5) {
+        gl_Position = vec4(0.0);
+        return;
+    }
+    vec3 size = vec3(1.0);
+    size[face_axes[normal_idx].x] = float(((a_data >> 5) & 0xF) + 1);
+    size[face_axes[normal_idx].y] = float(((a_data >> 9) & 0xF) + 1);
+    int corner = face_corners[normal_idx * 4 + triangle_corners[gl_VertexID]];
+
     // compute world offset
     vec3 pos = vec3(
-        float((a_data & 0xF) >> 0),
-        float((a_data & 0xFF0) >> 4),
-        float((a_data & 0xF000) >> 12)
+        float((a_position >> 0) & 0x3FF),
+        float((a_position >> 10) & 0xFFF),
+        float((a_position >> 22) & 0x3FF)
     );
+    pos += cube_corners[corner] * size;
+    pos = min(pos * u_lod_scale, u_chunk_size);
     pos += u_chunk_offset * u_chunk_size;
 
     gl_Position = u_light_space * vec4(pos, 1.0);
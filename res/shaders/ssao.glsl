@@ -22,6 +22,8 @@ uniform sampler2D u_normal;
 
 uniform sampler2D u_noise;
 uniform vec3[64] u_ssao_samples;
+// how many of the samples are used, at most 64
+uniform int u_kernel_size;
 
 uniform mat4 u_projection;
 uniform mat4 u_view;
@@ -33,7 +35,7 @@ float rand(vec2 co) {
 float ssao(vec3 pos, vec3 normal, vec3 rot) {
     float radius = 0.5;
     float bias = 0.03;
-    int kernel_size = 32;
+    int kernel_size = clamp(u_kernel_size, 1, 64);
 
     vec3 tangent = normalize(rot - normal * dot(rot, normal));
     vec3 bitangent = cross(normal, tangent);
@@ -1,43 +1,121 @@
 #ifndef VOXEL_ENTITY_BLOCK_HPP
 #define VOXEL_ENTITY_BLOCK_HPP
 
+#include <array>
+#include <unordered_map>
+
 #include "omega/math/math.hpp"
 #include "omega/util/types.hpp"
 
-enum class BlockType : i8 {
-    NONE = -1,
-    GRASS = 0,
-    STONE = 1,
-    BRICK = 2,
-    COAL = 3,
-    DIRT = 4,
-    ICE = 5,
-    SAND = 6,
-    SNOW = 7,
-    TREE_TRUNK = 8,
-    LEAF = 9,
-    JUNGLE_GRASS = 10,
-    RED_SAND = 11,
+enum class BlockType : u16 {
+    NONE = 0,
+    GRASS = 1,
+    STONE = 2,
+    BRICK = 3,
+    COAL = 4,
+    DIRT = 5,
+    ICE = 6,
+    SAND = 7,
+    SNOW = 8,
+    TREE_TRUNK = 9,
+    LEAF = 10,
+    JUNGLE_GRASS = 11,
+    RED_SAND = 12,
 };
 
+// tiles per row in blocks.png
+constexpr static u32 block_atlas_size = 4;
+
+/**
+ * Properties of a block type, looked up by id from block_registry so the
+ * mesher doesn't have to branch on the type
+ */
+struct BlockInfo {
+    bool solid = false;      // takes up space, air is the only non solid block
+    bool opaque = false;     // hides the faces of any block next to it
+    bool culls_self = false; // hides the faces between two of this block
+    std::array<u16, 6> tiles{}; // atlas tile per Direction
+    u8 shininess = 0;
+};
+
+constexpr BlockInfo opaque_block(u16 tile, u8 shininess = 0) {
+    return BlockInfo{.solid = true,
+                     .opaque = true,
+                     .culls_self = true,
+                     .tiles = {tile, tile, tile, tile, tile, tile},
+                     .shininess = shininess};
+}
+
+// see-through blocks only hide faces shared with the same type
+constexpr BlockInfo transparent_block(u16 tile, u8 shininess = 0) {
+    BlockInfo info = opaque_block(tile, shininess);
+    info.opaque = false;
+    return info;
+}
+
+// indexed by BlockType, tiles are laid out in block id order in blocks.png
+constexpr static std::array<BlockInfo, 13> block_registry = {
+    BlockInfo{},                // NONE
+    opaque_block(0),            // GRASS
+    opaque_block(1, 128),       // STONE
+    opaque_block(2),            // BRICK
+    opaque_block(3),            // COAL
+    opaque_block(4),            // DIRT
+    opaque_block(5, 32),        // ICE
+    opaque_block(6),            // SAND
+    opaque_block(7, 4),         // SNOW
+    opaque_block(8),            // TREE_TRUNK
+    transparent_block(9),       // LEAF
+    opaque_block(10),           // JUNGLE_GRASS
+    opaque_block(11),           // RED_SAND
+};
+
+constexpr const BlockInfo &block_info(BlockType type) {
+    return block_registry[(u16)type];
+}
+
+// true if the face of a block of type self touching neighbor can't be seen
+constexpr bool face_hidden(BlockType self, BlockType neighbor) {
+    const BlockInfo &info = block_info(neighbor);
+    return info.opaque | (info.culls_self & (self == neighbor));
+}
+
+/**
+ * A block is only its type, its position is implied by its index in the
+ * chunk (see Chunk::get_index/get_xyz), keeping chunk storage at 2 bytes per
+ * cell
+ */
 struct Block {
     BlockType type = BlockType::NONE;
-    bool is_active() {
-        return type != BlockType::NONE;
+    bool is_active() const {
+        return block_info(type).solid;
     }
     u8 shininess() const {
-        if (type == BlockType::ICE) {
-            return 32;
-        }
-        if (type == BlockType::SNOW) {
-            return 4;
-        }
-        if (type == BlockType::STONE) {
-            return 128;
-        }
-        return 0;
+        return block_info(type).shininess;
+    }
+};
+
+static_assert(sizeof(Block) == sizeof(BlockType),
+              "Block must stay a dense block id");
+
+/**
+ * Extra per-block state, most blocks have none so it's kept out of the dense
+ * block storage in a sparse map per chunk (see BlockStates)
+ */
+struct BlockState {
+    u8 orientation = 0; // quarter turns of the block's texture
+    u8 level = 0;       // fluid level
+
+    bool empty() const {
+        return orientation == 0 && level == 0;
     }
-    u8 x = 0, y = 0, z = 0;
 };
 
+// block states keyed by state_key(x, y, z) of the block in its chunk
+using BlockStates = std::unordered_map<u32, BlockState>;
+
+constexpr u32 state_key(u32 x, u32 y, u32 z) {
+    return (y << 20) | (z << 10) | x;
+}
+
 #endif // VOXEL_ENTITY_BLOCK_HPP
@@ -1,239 +1,1234 @@
 #include "voxel/entity/chunk.hpp"
 
+#include <bit>
+
 #include "voxel/entity/block.hpp"
 #include "voxel/entity/water.hpp"
 #include "voxel/util/worldgen.hpp"
 
-static void compress_vertex(const omega::math::ivec3 &pos,
-                            Direction normal,
-                            const omega::math::ivec2 &tex_uv,
-                            Vertex &vertex) {
-    uint32_t data = 0;
-    // set position
-    data |= (pos.x << 0) & 0xF;
-    data |= (pos.y << 4) & 0xFF0;
-    data |= (pos.z << 12) & 0xF000;
-    // set normal
-    data |= ((uint8_t)(normal) << 16) & 0x70000;
-    // set tex coord x
-    data |= (tex_uv.x << 19) & 0x380000;
-    // set tex coord y
-    data |= (tex_uv.y << 22) & 0x1C00000;
-    vertex.data = data;
-}
-
-static void create_quad(size_t x,
-                        size_t y,
-                        size_t z,
-                        int8_t type,
-                        std::vector<Quad> &quads,
-                        Direction direction) {
-    // calculate vertex positions
-    omega::math::ivec3 vertex_positions[8];
-    // back
-    vertex_positions[0] = omega::math::ivec3(x, y, z);     // bottom left back
-    vertex_positions[1] = omega::math::ivec3(x + 1, y, z); // bottom right back
-    vertex_positions[2] = omega::math::ivec3(x + 1, y + 1, z); // top right back
-    vertex_positions[3] = omega::math::ivec3(x, y + 1, z);     // top left back
-
-    // front
-    vertex_positions[4] = omega::math::ivec3(x, y, z + 1); // bottom left front
-    vertex_positions[5] =
-        omega::math::ivec3(x + 1, y, z + 1); // bottom right front
-    vertex_positions[6] =
-        omega::math::ivec3(x + 1, y + 1, z + 1); // top right front
-    vertex_positions[7] = omega::math::ivec3(x, y + 1, z + 1); // top left front
-
-    // set the texture coords
-    omega::math::ivec2 tex_offset =
-        omega::math::vec2((float)(type % 4), (float)(type / 4));
-    omega::math::ivec2 tex_coord_bl = omega::math::ivec2(0, 0) + tex_offset;
-    omega::math::ivec2 tex_coord_br = omega::math::ivec2(1, 0) + tex_offset;
-    omega::math::ivec2 tex_coord_tr = omega::math::ivec2(1, 1) + tex_offset;
-    omega::math::ivec2 tex_coord_tl = omega::math::ivec2(0, 1) + tex_offset;
+// every tile has to fit in the quad's data
+static_assert(
+    []() {
+        for (const BlockInfo &info : block_registry) {
+            for (u16 tile : info.tiles) {
+                if (tile >= (1u << quad_tile_bits)) return false;
+            }
+        }
+        return true;
+    }(),
+    "block tile doesn't fit in a quad");
 
+/**
+ * Creates the face of the block at pos facing direction, stretched over
+ * width by height blocks along the face's axes when greedy meshing
+ * The texture coordinates come from the corner positions in the shader so
+ * the texture repeats once per block across the face, ao is the occlusion
+ * of each corner, see Chunk::face_ao()
+ */
+static void create_quad(const omega::math::ivec3 &pos,
+                        u32 width,
+                        u32 height,
+                        BlockType type,
+                        BlockState state,
+                        std::vector<Quad> &quads,
+                        Direction direction,
+                        u8 ao = 0) {
+    constexpr uint32_t x_mask = (1u << vertex_x_bits) - 1;
+    constexpr uint32_t y_mask = (1u << vertex_y_bits) - 1;
+    constexpr uint32_t z_mask = (1u << vertex_z_bits) - 1;
     Quad q;
-    switch (direction) {
-        case Direction::left: {
-            compress_vertex(vertex_positions[0], direction, tex_coord_bl, q[0]);
-            compress_vertex(vertex_positions[4], direction, tex_coord_br, q[1]);
-            compress_vertex(vertex_positions[7], direction, tex_coord_tr, q[2]);
-            compress_vertex(vertex_positions[7], direction, tex_coord_tr, q[3]);
-            compress_vertex(vertex_positions[3], direction, tex_coord_tl, q[4]);
-            compress_vertex(vertex_positions[0], direction, tex_coord_bl, q[5]);
-            break;
-        }
-        case Direction::right: {
-            compress_vertex(vertex_positions[5], direction, tex_coord_bl, q[0]);
-            compress_vertex(vertex_positions[1], direction, tex_coord_br, q[1]);
-            compress_vertex(vertex_positions[2], direction, tex_coord_tr, q[2]);
-            compress_vertex(vertex_positions[2], direction, tex_coord_tr, q[3]);
-            compress_vertex(vertex_positions[6], direction, tex_coord_tl, q[4]);
-            compress_vertex(vertex_positions[5], direction, tex_coord_bl, q[5]);
-            break;
-        }
-        case Direction::top: {
-            compress_vertex(vertex_positions[7], direction, tex_coord_bl, q[0]);
-            compress_vertex(vertex_positions[6], direction, tex_coord_br, q[1]);
-            compress_vertex(vertex_positions[2], direction, tex_coord_tr, q[2]);
-            compress_vertex(vertex_positions[2], direction, tex_coord_tr, q[3]);
-            compress_vertex(vertex_positions[3], direction, tex_coord_tl, q[4]);
-            compress_vertex(vertex_positions[7], direction, tex_coord_bl, q[5]);
-            break;
-        }
-        case Direction::bottom: {
-            compress_vertex(vertex_positions[4], direction, tex_coord_bl, q[0]);
-            compress_vertex(vertex_positions[5], direction, tex_coord_br, q[1]);
-            compress_vertex(vertex_positions[1], direction, tex_coord_tr, q[2]);
-            compress_vertex(vertex_positions[1], direction, tex_coord_tr, q[3]);
-            compress_vertex(vertex_positions[0], direction, tex_coord_tl, q[4]);
-            compress_vertex(vertex_positions[4], direction, tex_coord_bl, q[5]);
-            break;
-        }
-        case Direction::forward: {
-            compress_vertex(vertex_positions[4], direction, tex_coord_bl, q[0]);
-            compress_vertex(vertex_positions[5], direction, tex_coord_br, q[1]);
-            compress_vertex(vertex_positions[6], direction, tex_coord_tr, q[2]);
-            compress_vertex(vertex_positions[6], direction, tex_coord_tr, q[3]);
-            compress_vertex(vertex_positions[7], direction, tex_coord_tl, q[4]);
-            compress_vertex(vertex_positions[4], direction, tex_coord_bl, q[5]);
-            break;
-        }
-        case Direction::backward: {
-            compress_vertex(vertex_positions[0], direction, tex_coord_bl, q[0]);
-            compress_vertex(vertex_positions[1], direction, tex_coord_br, q[1]);
-            compress_vertex(vertex_positions[2], direction, tex_coord_tr, q[2]);
-            compress_vertex(vertex_positions[2], direction, tex_coord_tr, q[3]);
-            compress_vertex(vertex_positions[3], direction, tex_coord_tl, q[4]);
-            compress_vertex(vertex_positions[0], direction, tex_coord_bl, q[5]);
-            break;
-        }
-    }
+    // set position
+    uint32_t position = 0;
+    position |= ((uint32_t)pos.x & x_mask) << 0;
+    position |= ((uint32_t)pos.y & y_mask) << vertex_x_bits;
+    position |= ((uint32_t)pos.z & z_mask) << (vertex_x_bits + vertex_y_bits);
+    q.position = position;
+
+    uint32_t data = 0;
+    // set normal
+    data |= ((uint8_t)(direction) << 0) & 0x7;
+    // set texture orientation
+    data |= ((uint32_t)state.orientation << 3) & 0x18;
+    // set size
+    data |= ((width - 1) << 5) & 0x1E0;
+    data |= ((height - 1) << 9) & 0x1E00;
+    // set atlas tile
+    const u16 tile = block_info(type).tiles[(u8)direction];
+    data |= ((uint32_t)tile << 13) & 0xFFE000;
+    // set ambient occlusion
+    data |= (uint32_t)ao << 24;
+    q.data = data;
     quads.push_back(q);
 }
 
-Chunk::Chunk(const omega::math::vec3 &position) : position(position) {
+// ordered the same as Direction
+constexpr static std::array<omega::math::ivec3, 6> face_normals = {
+    omega::math::ivec3(-1, 0, 0), omega::math::ivec3(1, 0, 0),
+    omega::math::ivec3(0, 0, 1),  omega::math::ivec3(0, 0, -1),
+    omega::math::ivec3(0, 1, 0),  omega::math::ivec3(0, -1, 0)};
+
+// the normal axis followed by the face's u and v axes of each direction
+// x = 0, y = 1, z = 2, ordered the same as Direction
+constexpr static u8 face_axes[6][3] = {
+    {0, 2, 1}, // left
+    {0, 2, 1}, // right
+    {2, 0, 1}, // forward
+    {2, 0, 1}, // backward
+    {1, 0, 2}, // top
+    {1, 0, 2}, // bottom
+};
+
+// recycled buffers shared by every chunk
+// the high water marks cap how much each pool holds on to
+static Pool<omega::util::uptr<Block[]>> &section_pool() {
+    static Pool<omega::util::uptr<Block[]>> pool(4096, []() {
+        return omega::util::uptr<Block[]>(new Block[Chunk::section_cubes]);
+    });
+    return pool;
+}
+
+static Pool<omega::util::uptr<ChunkMesh>> &mesh_pool() {
+    static Pool<omega::util::uptr<ChunkMesh>> pool(
+        256, []() { return omega::util::create_uptr<ChunkMesh>(); });
+    return pool;
+}
+
+static Pool<std::vector<Quad>> &quad_pool() {
+    static Pool<std::vector<Quad>> pool(
+        16, []() { return std::vector<Quad>(); });
+    return pool;
+}
+
+ChunkMesh::ChunkMesh() {
     vao = omega::util::create_uptr<omega::gfx::VertexArray>();
+    vbo = omega::util::create_uptr<omega::gfx::VertexBuffer>(nullptr, 0);
+    omega::gfx::VertexBufferLayout layout;
+    layout.push(GL_INT, 1); // position
+    layout.push(GL_INT, 1); // data
+    vao->add_buffer(*vbo, layout);
+    // each quad is an instance, its corners come from gl_VertexID
+    vao->bind();
+    glVertexAttribDivisor(0, 1);
+    glVertexAttribDivisor(1, 1);
+    vao->unbind();
+    glGenBuffers(1, &commands);
+}
+
+ChunkMesh::~ChunkMesh() {
+    glDeleteBuffers(1, &commands);
+}
 
+void ChunkMesh::upload(const void *data, size_t size) {
+    // respecify the whole buffer, the VAO keeps pointing at it
+    vbo->bind();
+    glBufferData(GL_ARRAY_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    vbo->unbind();
+}
+
+void ChunkMesh::update(size_t offset, const void *data, size_t size) {
+    vbo->bind();
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+    vbo->unbind();
+}
+
+void ChunkMesh::set_commands(const DrawCommand *data, size_t count) {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 count * sizeof(DrawCommand),
+                 data,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+Chunk::Chunk(const omega::math::vec3 &position, bool deferred)
+    : position(position) {
+    if (deferred) return;
     // create the blocks using perlin noise and other algorithms
-    gen_blocks();
+    generate();
     // generate the mesh
     load_mesh();
 }
 
 Chunk::~Chunk() {
-    if (blocks == nullptr) {
-        delete[] blocks;
+    for (Section &section : sections) {
+        if (section.blocks != nullptr) {
+            section_pool().release(std::move(section.blocks));
+        }
     }
-    blocks = nullptr;
+    release_mesh();
 }
 
-void Chunk::render(float dt) {
+void Chunk::render(float dt, u8 faces) {
     (void)dt;
-    vao->bind();
-    omega::gfx::draw_arrays(OMEGA_GL_TRIANGLES, 0, vbo_offset);
-    vao->unbind();
+    if (mesh == nullptr) return;
+    mesh->vao->bind();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mesh->commands);
+    for (u8 d = 0; d < 6;) {
+        if (!((faces >> d) & 1)) {
+            ++d;
+            continue;
+        }
+        // the commands of neighbouring directions sit one after the other,
+        // draw a run of them at once
+        const u32 first = draws[d].first;
+        u32 count = 0;
+        for (; d < 6 && ((faces >> d) & 1); ++d) {
+            count += draws[d].count;
+        }
+        if (count == 0) continue;
+        glMultiDrawArraysIndirect(
+            OMEGA_GL_TRIANGLES,
+            (const void *)(uintptr_t)(first * sizeof(DrawCommand)),
+            count,
+            0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    mesh->vao->unbind();
 }
 
-void Chunk::init_block(size_t x, size_t y, size_t z, int8_t type) {
-    static std::vector<Direction> directions_to_add;
-    directions_to_add.clear();
+u8 Chunk::faces_toward(const omega::math::vec3 &eye) const {
+    // a face can only be seen from in front of its plane, the planes of the
+    // chunk's faces lie within its bounds
+    const omega::math::vec3 lo =
+        position * dimens + omega::math::vec3(0.0f, (f32)min_y, 0.0f);
+    const omega::math::vec3 hi =
+        position * dimens +
+        omega::math::vec3((f32)width, (f32)max_y, (f32)depth);
+    u8 faces = 0;
+    faces |= (u8)(eye.x < hi.x) << (u8)Direction::left;
+    faces |= (u8)(eye.x > lo.x) << (u8)Direction::right;
+    faces |= (u8)(eye.z > lo.z) << (u8)Direction::forward;
+    faces |= (u8)(eye.z < hi.z) << (u8)Direction::backward;
+    faces |= (u8)(eye.y > lo.y) << (u8)Direction::top;
+    faces |= (u8)(eye.y < hi.y) << (u8)Direction::bottom;
+    return faces;
+}
 
-    // get all faces that need to be created
-    get_face_directions(x, y, z, directions_to_add);
+u8 Chunk::faces_along(const omega::math::vec3 &view_dir) {
+    // faces pointing against the view direction
+    u8 faces = 0;
+    faces |= (u8)(view_dir.x > 0.0f) << (u8)Direction::left;
+    faces |= (u8)(view_dir.x < 0.0f) << (u8)Direction::right;
+    faces |= (u8)(view_dir.z < 0.0f) << (u8)Direction::forward;
+    faces |= (u8)(view_dir.z > 0.0f) << (u8)Direction::backward;
+    faces |= (u8)(view_dir.y < 0.0f) << (u8)Direction::top;
+    faces |= (u8)(view_dir.y > 0.0f) << (u8)Direction::bottom;
+    return faces;
+}
 
-    // create a face for each direction
-    for (Direction direction : directions_to_add) {
-        create_quad(x, y, z, type, quads_to_add, direction);
-        vbo_offset += 6;
+void Chunk::remove_block(size_t x, size_t y, size_t z) {
+    if (x < width && y < height && z < depth) {
+        set_block(x, y, z, BlockType::NONE);
+        states.erase(state_key(x, y, z));
     }
 }
 
-void Chunk::remove_block(size_t x, size_t y, size_t z) {
-    size_t idx = get_index(x, y, z);
-    if (idx < width * height * depth) {
-        blocks[idx].type = BlockType::NONE;
+void Chunk::add_block(size_t x,
+                      size_t y,
+                      size_t z,
+                      BlockType type,
+                      BlockState state) {
+    if (x < width && y < height && z < depth) {
+        set_block(x, y, z, type);
+        set_state(x, y, z, state);
     }
 }
 
-void Chunk::add_block(size_t x, size_t y, size_t z, int8_t type) {
-    size_t idx = get_index(x, y, z);
-    if (idx < width * height * depth) {
-        blocks[idx].type = (BlockType)type;
+void Chunk::set_neighbor(Direction side, const Chunk *neighbor) {
+    std::array<BorderRow, height> border{};
+    if (neighbor != nullptr) {
+        // the neighbour's layer touching this side
+        const bool along_z =
+            side == Direction::left || side == Direction::right;
+        size_t layer = 0;
+        if (side == Direction::left) layer = width - 1;
+        if (side == Direction::backward) layer = depth - 1;
+        const size_t count = along_z ? depth : width;
+        for (size_t y = neighbor->min_y; y < neighbor->max_y; ++y) {
+            BorderRow &row = border[y];
+            for (size_t a = 0; a < count; ++a) {
+                const bool opaque =
+                    y < neighbor->solid_y ||
+                    block_info(along_z ? neighbor->get_block(layer, y, a)
+                                       : neighbor->get_block(a, y, layer))
+                        .opaque;
+                row[a >> 6] |= (u64)opaque << (a & 63);
+            }
+        }
+    }
+    auto &current = borders[(u8)side];
+    if (current != border) {
+        current = border;
+        // the side faces run the whole height of the chunk
+        dirty.set();
     }
 }
 
-void Chunk::update_chunk() {
-    // clear quads to add
-    quads_to_add.clear();
-    vbo_offset = 0;
+void Chunk::set_lod(u32 level) {
+    level = std::min(level, max_lod);
+    if (level == lod) return;
+    lod = level;
+    dirty.set();
+}
 
+void Chunk::set_state(size_t x, size_t y, size_t z, BlockState state) {
+    edited = true;
+    // only blocks with state take up memory
+    if (state.empty()) {
+        states.erase(state_key(x, y, z));
+    } else {
+        states[state_key(x, y, z)] = state;
+    }
+}
+
+void Chunk::set_block(size_t x, size_t y, size_t z, BlockType type) {
+    Section &section = sections[y >> section_shift];
+    if (section.uniform) {
+        if (section.type == type) return;
+        // expand the section so it can hold different types
+        section.blocks = section_pool().acquire();
+        std::fill_n(section.blocks.get(), section_cubes, Block{section.type});
+        section.uniform = false;
+    }
+    section.blocks[get_index(x, y, z)].type = type;
+    update_bounds(x, y, z, type);
+    edited = true;
+    if (x == 0 || x == width - 1 || z == 0 || z == depth - 1) {
+        border_edited = true;
+    }
+    // the faces of the blocks above and below can be in the next sections
+    const u32 s = y >> section_shift;
+    const u32 layer = y & (section_height - 1);
+    dirty.set(s);
+    if (layer == 0 && s > 0) dirty.set(s - 1);
+    if (layer == section_height - 1 && s + 1 < num_sections) dirty.set(s + 1);
+}
+
+void Chunk::update_bounds(size_t x, size_t y, size_t z, BlockType type) {
+    u16 &top = heightmap[z * width + x];
+    // see-through blocks can show the faces around them
+    if (!block_info(type).opaque) {
+        solid_y = std::min(solid_y, (u32)y);
+    }
+    if (type != BlockType::NONE) {
+        if (min_y >= max_y) {
+            min_y = y;
+        }
+        min_y = std::min(min_y, (u32)y);
+        top = std::max(top, (u16)(y + 1));
+        max_y = std::max(max_y, (u32)top);
+        return;
+    }
+
+    // lower the column if its highest block was removed
+    if (y + 1 == top) {
+        while (top > 0 && !block_active(x, top - 1, z)) {
+            --top;
+        }
+        if (y + 1 == max_y) {
+            max_y = *std::max_element(heightmap.begin(), heightmap.end());
+        }
+    }
+    // raise the bottom if its last block was removed
+    if (y == min_y) {
+        while (min_y < max_y && layer_empty(min_y)) {
+            ++min_y;
+        }
+    }
+    if (min_y >= max_y) {
+        min_y = max_y = 0;
+    }
+}
+
+bool Chunk::layer_empty(size_t y) const {
+    const Section &section = sections[y >> section_shift];
+    if (section.uniform) return section.type == BlockType::NONE;
+    const Block *layer = &section.blocks[get_index(0, y, 0)];
+    return std::all_of(layer, layer + width * depth, [](const Block &b) {
+        return b.type == BlockType::NONE;
+    });
+}
+
+void Chunk::update_chunk() {
     load_mesh();
 }
 
-void Chunk::gen_blocks() {
-    // initialize with empty blocks
-    blocks = new Block[max_cubes];
-    omega::core::assert(blocks != nullptr, "No memory available for blocks!");
+void Chunk::compress() {
+    if (compressed) return;
+    for (Section &section : sections) {
+        if (section.uniform) continue;
+        section.packed.pack(section.blocks.get(), section_cubes);
+        section_pool().release(std::move(section.blocks));
+        section.blocks = nullptr;
+    }
+    compressed = true;
+}
 
-    // fill with clear blocks
-    size_t x, y, z;
-    for (size_t i = 0; i < max_cubes; ++i) {
-        get_xyz(i, x, y, z);
-        blocks[i] = Block{BlockType::NONE, (u8)x, (u8)y, (u8)z};
+void Chunk::decompress() {
+    if (!compressed) return;
+    for (Section &section : sections) {
+        if (section.uniform) continue;
+        section.blocks = section_pool().acquire();
+        section.packed.unpack(section.blocks.get());
+        section.packed.clear();
     }
+    compressed = false;
+}
+
+void Chunk::release_mesh() {
+    if (mesh != nullptr) {
+        mesh_pool().release(std::move(mesh));
+        mesh = nullptr;
+    }
+    release_staging();
+    num_quads = 0;
+}
+
+Chunk::PoolStats Chunk::pool_stats() {
+    return PoolStats{.sections = section_pool().size(),
+                     .meshes = mesh_pool().size(),
+                     .quad_buffers = quad_pool().size()};
+}
+
+void Chunk::clear_pools() {
+    section_pool().clear();
+    mesh_pool().clear();
+    quad_pool().clear();
+}
+
+size_t Chunk::compressed_size() const {
+    size_t size = 0;
+    for (const Section &section : sections) {
+        size += section.packed.size_bytes();
+    }
+    return size;
+}
+
+void Chunk::generate_batch(const std::vector<Chunk *> &chunks,
+                           WorkerPool &workers) {
+    // every chunk only touches its own blocks
+    workers.parallel_for(chunks.size(), [&chunks](u32 i) {
+        chunks[i]->generate();
+    });
+}
+
+// dense buffer generation writes into before it's split into sections
+static std::vector<Block> &generation_scratch() {
+    static thread_local std::vector<Block> scratch(Chunk::max_cubes);
+    std::fill(scratch.begin(), scratch.end(), Block{});
+    return scratch;
+}
+
+void Chunk::generate() {
+    std::vector<Block> &scratch = generation_scratch();
+    const WorldGen *generator = WorldGen::instance();
+    states.clear();
+    const WorldGen::Bounds bounds = generator->gen(scratch.data(),
+                                                   heightmap.data(),
+                                                   states,
+                                                   position,
+                                                   width,
+                                                   depth,
+                                                   height);
+    load_generated(scratch.data(), bounds.ground, bounds.top);
+}
+
+void Chunk::sample_region(const std::vector<Chunk *> &chunks,
+                          WorldGen::Region &region) {
+    if (chunks.empty()) return;
+    omega::math::vec3 low = chunks.front()->position, high = low;
+    for (const Chunk *chunk : chunks) {
+        low = omega::math::min(low, chunk->position);
+        high = omega::math::max(high, chunk->position);
+    }
+    WorldGen::instance()->sample_region(region,
+                                        low,
+                                        (u32)(high.x - low.x) + 1,
+                                        (u32)(high.z - low.z) + 1,
+                                        width,
+                                        depth);
+}
+
+void Chunk::generate(const WorldGen::Region &region) {
+    std::vector<Block> &scratch = generation_scratch();
+    const WorldGen *generator = WorldGen::instance();
+    states.clear();
+    const WorldGen::Bounds bounds = generator->gen(region,
+                                                   scratch.data(),
+                                                   heightmap.data(),
+                                                   states,
+                                                   position,
+                                                   height);
+    load_generated(scratch.data(), bounds.ground, bounds.top);
+}
+
+void Chunk::link_region(const std::vector<Chunk *> &chunks) {
+    for (Chunk *chunk : chunks) {
+        for (const Chunk *other : chunks) {
+            const omega::math::ivec3 offset(other->position - chunk->position);
+            for (u8 d = 0; d < 4; ++d) {
+                if (offset == face_normals[d]) {
+                    chunk->set_neighbor((Direction)d, other);
+                }
+            }
+        }
+    }
+}
 
-    auto *generator = WorldGen::instance();
-    generator->gen(blocks, position, width, depth, height);
+void Chunk::load_generated(const Block *scratch, u32 ground, u32 top) {
+    // the generator always starts from a solid floor
+    solid_y = ground;
+    min_y = 0;
+    // nothing is generated at or above top
+    max_y = top;
+
+    const auto scratch_idx = [](size_t x, size_t y, size_t z) {
+        return (z * width * height) + (y * width) + x;
+    };
+    for (u32 s = 0; s < num_sections; ++s) {
+        Section &section = sections[s];
+        const u32 y_start = s * section_height;
+        const u32 y_end = std::min(y_start + section_height, height);
+        section.uniform = true;
+        section.type = BlockType::NONE;
+        if (y_start >= top) continue;
+
+        // check if the whole section is one type
+        section.type = scratch[scratch_idx(0, y_start, 0)].type;
+        for (u32 z = 0; z < depth && section.uniform; ++z) {
+            for (u32 y = y_start; y < y_end && section.uniform; ++y) {
+                const Block *row = &scratch[scratch_idx(0, y, z)];
+                for (u32 x = 0; x < width; ++x) {
+                    if (row[x].type != section.type) {
+                        section.uniform = false;
+                        break;
+                    }
+                }
+            }
+        }
+        if (section.uniform) continue;
+
+        section.blocks = section_pool().acquire();
+        if (y_end - y_start < section_height) {
+            // clear the rows past the top of the chunk
+            std::fill_n(section.blocks.get(), section_cubes, Block{});
+        }
+        for (u32 y = y_start; y < y_end; ++y) {
+            for (u32 z = 0; z < depth; ++z) {
+                std::copy_n(&scratch[scratch_idx(0, y, z)],
+                            width,
+                            &section.blocks[get_index(0, y, z)]);
+            }
+        }
+    }
 }
 
+/**
+ * Occupancy and visible faces of a chunk's occupied band stored as rows of
+ * bits along x, one row per (y, z)
+ * Finding the faces of a whole row of blocks then takes a few shifts and ANDs
+ * instead of six neighbour lookups per block
+ */
+struct FaceMasks {
+    constexpr static u32 words = (Chunk::width + 63) / 64;
+    using Row = std::array<u64, words>;
+
+    // layers packed into rows, one more than the faces on each side so the
+    // faces can see their neighbours
+    u32 y_start = 0, y_end = 0;
+    // layers the faces were found for
+    u32 face_start = 0, face_end = 0;
+    std::vector<Row> solid;
+    std::vector<Row> opaque;
+    // solid see-through blocks that hide faces against their own type
+    std::vector<Row> culls_self;
+    // indexed by Direction
+    std::array<std::vector<Row>, 6> faces;
+
+    size_t row(size_t y, size_t z) const {
+        return (y - y_start) * Chunk::depth + z;
+    }
+
+    static bool test(const Row &row, size_t x) {
+        return (row[x >> 6] >> (x & 63)) & 1;
+    }
+};
+
 void Chunk::load_mesh() {
-    // create all the necessary faces
-    for (size_t i = 0; i < max_cubes; ++i) {
-        Block &b = blocks[i];
-        if (b.type != BlockType::NONE) {
-            init_block(b.x, b.y, b.z, (i8)b.type);
+    build_mesh();
+    upload_mesh();
+}
+
+// direction of a quad, see Quad
+static u8 quad_direction(const Quad &quad) {
+    return quad.data & 0x7;
+}
+
+// empty_quads left after a section's quads of one direction, an empty
+// range gets none as filling it lays the mesh out again anyway
+// a section has a range per direction, so the fixed part is kept to one
+static u32 range_padding(u32 count) {
+    return count == 0 ? 0 : count / 4 + 1;
+}
+
+void Chunk::build_mesh() {
+    if (built_quads.capacity() == 0) {
+        built_quads = quad_pool().acquire();
+    }
+    dirty.reset();
+    built_lod = lod;
+    // scratch is per thread so chunks can be meshed in parallel
+    static thread_local FaceMasks masks;
+    static thread_local std::vector<Quad> quads;
+    // where each section's quads start in quads
+    std::array<u32, num_sections + 1> starts{};
+    quads.clear();
+    if (lod > 0) {
+        // everything goes in the first section, coarse meshes aren't patched
+        load_lod_mesh(lod, quads);
+        starts.fill(quads.size());
+        starts[0] = 0;
+    } else {
+        for (u32 s = 0; s < num_sections; ++s) {
+            starts[s] = quads.size();
+            mesh_section(s, masks, quads);
+        }
+        starts[num_sections] = quads.size();
+    }
+    layout_mesh(quads, starts, lod == 0, built_quads, built_ranges);
+}
+
+void Chunk::layout_mesh(const std::vector<Quad> &quads,
+                        const std::array<u32, num_sections + 1> &sections,
+                        bool padded,
+                        std::vector<Quad> &mesh,
+                        MeshRanges &ranges) {
+    // a direction at a time, its sections one after the other each with
+    // room to grow
+    mesh.clear();
+    for (u8 d = 0; d < 6; ++d) {
+        for (u32 s = 0; s < num_sections; ++s) {
+            SectionRange &range = ranges[d][s];
+            range.offset = mesh.size();
+            for (u32 i = sections[s]; i < sections[s + 1]; ++i) {
+                if (quad_direction(quads[i]) == d) mesh.push_back(quads[i]);
+            }
+            range.count = mesh.size() - range.offset;
+            range.capacity =
+                range.count + (padded ? range_padding(range.count) : 0);
+            mesh.resize(range.offset + range.capacity, empty_quad);
         }
     }
-    // send all quads to the GPU
-    vbo = omega::util::create_uptr<omega::gfx::VertexBuffer>(
-        quads_to_add.data(), sizeof(Quad) * quads_to_add.size());
-    omega::gfx::VertexBufferLayout layout;
-    layout.push(GL_INT, 1); // data
-    vao->add_buffer(*vbo, layout);
 }
 
-void Chunk::get_face_directions(size_t x,
-                                size_t y,
-                                size_t z,
-                                std::vector<Direction> &directions) {
-    // handle z axis faces
-    // check back face, z - 1
-    if (z == 0 || !blocks[get_index(x, y, z - 1)].is_active()) {
-        directions.push_back(Direction::backward);
+void Chunk::remesh_dirty() {
+    if (dirty.none()) return;
+    // coarse meshes are small enough to always rebuild
+    if (mesh == nullptr || dirty.all() || lod != 0 || mesh_lod != 0) {
+        update_chunk();
+        return;
     }
-    // check front face, z + 1
-    if (z == depth - 1 || !blocks[get_index(x, y, z + 1)].is_active()) {
-        directions.push_back(Direction::forward);
+    static thread_local FaceMasks masks;
+    static thread_local std::vector<Quad> quads;
+    // only the patched ranges are staged, the rest of the mesh lives on the
+    // GPU alone
+    static thread_local std::vector<Quad> staging;
+    for (u32 s = 0; s < num_sections; ++s) {
+        if (!dirty.test(s)) continue;
+        quads.clear();
+        mesh_section(s, masks, quads);
+        std::array<u32, 6> counts{};
+        for (const Quad &quad : quads) {
+            ++counts[quad_direction(quad)];
+        }
+        for (u8 d = 0; d < 6; ++d) {
+            if (counts[d] > ranges[d][s].capacity) {
+                // out of room, lay the whole mesh out again
+                update_chunk();
+                return;
+            }
+        }
+        // patch the section's range of each direction, padding what it no
+        // longer uses
+        for (u8 d = 0; d < 6; ++d) {
+            SectionRange &range = ranges[d][s];
+            // skip ranges that were and still are empty
+            if (range.count == 0 && counts[d] == 0) continue;
+            staging.clear();
+            for (const Quad &quad : quads) {
+                if (quad_direction(quad) == d) staging.push_back(quad);
+            }
+            staging.resize(range.capacity, empty_quad);
+            mesh->update(range.offset * sizeof(Quad),
+                         staging.data(),
+                         range.capacity * sizeof(Quad));
+            range.count = counts[d];
+        }
+        dirty.reset(s);
     }
+    upload_commands();
+}
 
-    // handle x axis faces
-    // check left face, x - 1
-    if (x == 0 || !blocks[get_index(x - 1, y, z)].is_active()) {
-        directions.push_back(Direction::left);
+void Chunk::mesh_section(u32 s,
+                         FaceMasks &masks,
+                         std::vector<Quad> &quads) const {
+    const u32 y_begin = std::max(s * section_height, min_y);
+    const u32 y_end = std::min((s + 1) * section_height, max_y);
+    // nothing to draw outside the band or in an empty section
+    if (y_begin >= y_end || section_empty(y_begin)) return;
+    find_faces(masks, y_begin, y_end);
+    if (mesh_mode == MeshMode::greedy) {
+        load_greedy_mesh(masks, quads);
+    } else {
+        load_naive_mesh(masks, quads);
     }
-    // check right face, x + 1
-    if (x == width - 1 || !blocks[get_index(x + 1, y, z)].is_active()) {
-        directions.push_back(Direction::right);
+}
+
+void Chunk::find_faces(FaceMasks &masks, u32 y_begin, u32 y_end) const {
+    using Row = FaceMasks::Row;
+    constexpr u32 words = FaceMasks::words;
+    // a row of all set bits, the last word only holds what's left of width
+    constexpr Row full = []() {
+        Row row{};
+        for (u32 w = 0; w < words; ++w) {
+            const u32 bits = std::min(width - w * 64, 64u);
+            row[w] = bits == 64 ? ~0ull : (1ull << bits) - 1;
+        }
+        return row;
+    }();
+
+    // only the occupied band can have faces, y_begin and y_end must be
+    // inside of it
+    masks.face_start = y_begin;
+    masks.face_end = y_end;
+    masks.y_start = y_begin > min_y ? y_begin - 1 : y_begin;
+    masks.y_end = y_end < max_y ? y_end + 1 : y_end;
+    const size_t rows = (masks.y_end - masks.y_start) * depth;
+    masks.solid.assign(rows, Row{});
+    masks.opaque.assign(rows, Row{});
+    masks.culls_self.assign(rows, Row{});
+    for (auto &faces : masks.faces) {
+        faces.assign(rows, Row{});
     }
 
-    // handle y axis faces
-    // check top face, y + 1
-    if (y == height - 1 || !blocks[get_index(x, y + 1, z)].is_active()) {
-        directions.push_back(Direction::top);
+    // 1. pack the block properties into rows
+    for (size_t y = masks.y_start; y < masks.y_end; ++y) {
+        const Section &section = sections[y >> section_shift];
+        const size_t first = masks.row(y, 0);
+        if (y < solid_y) {
+            // no need to read the blocks, they're all opaque
+            std::fill_n(&masks.solid[first], depth, full);
+            std::fill_n(&masks.opaque[first], depth, full);
+            continue;
+        }
+        if (section.uniform) {
+            const BlockInfo &info = block_info(section.type);
+            const Row row = info.solid ? full : Row{};
+            std::fill_n(&masks.solid[first], depth, row);
+            if (info.opaque) {
+                std::fill_n(&masks.opaque[first], depth, row);
+            } else if (info.culls_self) {
+                std::fill_n(&masks.culls_self[first], depth, row);
+            }
+            continue;
+        }
+        for (size_t z = 0; z < depth; ++z) {
+            const Block *b = &section.blocks[get_index(0, y, z)];
+            Row &solid = masks.solid[first + z];
+            Row &opaque = masks.opaque[first + z];
+            Row &culls_self = masks.culls_self[first + z];
+            for (size_t x = 0; x < width; ++x) {
+                const BlockInfo &info = block_info(b[x].type);
+                const u32 w = x >> 6, bit = x & 63;
+                solid[w] |= (u64)info.solid << bit;
+                opaque[w] |= (u64)info.opaque << bit;
+                culls_self[w] |= (u64)(info.culls_self & !info.opaque) << bit;
+            }
+        }
+    }
+
+    // 2. a face is visible if the block is solid and its neighbour isn't
+    // opaque, past the sides the neighbouring chunks' borders are used and
+    // anything above or below the band is air
+    const Row empty{};
+    const auto &left_border = borders[(u8)Direction::left];
+    const auto &right_border = borders[(u8)Direction::right];
+    for (size_t y = masks.face_start; y < masks.face_end; ++y) {
+        const u64 *forward_border = borders[(u8)Direction::forward][y].data();
+        const u64 *backward_border =
+            borders[(u8)Direction::backward][y].data();
+        for (size_t z = 0; z < depth; ++z) {
+            const size_t r = masks.row(y, z);
+            const Row &solid = masks.solid[r];
+            const Row &opaque = masks.opaque[r];
+            const u64 *forward =
+                z + 1 < depth ? masks.opaque[r + 1].data() : forward_border;
+            const u64 *backward =
+                z > 0 ? masks.opaque[r - 1].data() : backward_border;
+            const Row &top =
+                y + 1 < masks.y_end ? masks.opaque[r + depth] : empty;
+            const Row &bottom =
+                y > masks.y_start ? masks.opaque[r - depth] : empty;
+            const u64 left_edge = (left_border[y][z >> 6] >> (z & 63)) & 1;
+            const u64 right_edge = (right_border[y][z >> 6] >> (z & 63)) & 1;
+            u64 see_through = 0;
+            for (u32 w = 0; w < words; ++w) {
+                if (solid[w] == 0) continue;
+                // shift the neighbour on each side onto the block, carrying
+                // the bit that crosses into the next word
+                const u64 left = (opaque[w] << 1) |
+                                 (w > 0 ? opaque[w - 1] >> 63 : left_edge);
+                const u64 right =
+                    (opaque[w] >> 1) |
+                    (w + 1 < words ? opaque[w + 1] << 63
+                                   : right_edge << ((width - 1) & 63));
+                masks.faces[(u8)Direction::left][r][w] = solid[w] & ~left;
+                masks.faces[(u8)Direction::right][r][w] = solid[w] & ~right;
+                masks.faces[(u8)Direction::forward][r][w] =
+                    solid[w] & ~forward[w];
+                masks.faces[(u8)Direction::backward][r][w] =
+                    solid[w] & ~backward[w];
+                masks.faces[(u8)Direction::top][r][w] = solid[w] & ~top[w];
+                masks.faces[(u8)Direction::bottom][r][w] =
+                    solid[w] & ~bottom[w];
+                see_through |= masks.culls_self[r][w];
+            }
+            if (see_through == 0) continue;
+
+            // 3. see-through blocks also hide faces against their own type,
+            // they're rare enough to compare types one by one
+            // ordered the same as Direction
+            constexpr i32 offsets[6][3] = {{-1, 0, 0},
+                                           {1, 0, 0},
+                                           {0, 0, 1},
+                                           {0, 0, -1},
+                                           {0, 1, 0},
+                                           {0, -1, 0}};
+            for (u8 d = 0; d < 6; ++d) {
+                for (u32 w = 0; w < words; ++w) {
+                    u64 bits = masks.faces[d][r][w] & masks.culls_self[r][w];
+                    while (bits != 0) {
+                        const u64 bit = bits & -bits;
+                        bits ^= bit;
+                        const size_t x = w * 64 + std::countr_zero(bit);
+                        const size_t nx = x + offsets[d][0];
+                        const size_t ny = y + offsets[d][1];
+                        const size_t nz = z + offsets[d][2];
+                        // wraps around past the edges of the chunk
+                        if (nx >= width || ny >= height || nz >= depth) {
+                            continue;
+                        }
+                        if (get_block(nx, ny, nz) == get_block(x, y, z)) {
+                            masks.faces[d][r][w] &= ~bit;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool Chunk::occludes(const FaceMasks &masks,
+                     const omega::math::ivec3 &pos) const {
+    if (pos.y < 0 || pos.y >= (i32)height) return false;
+    const bool in_x = pos.x >= 0 && pos.x < (i32)width;
+    const bool in_z = pos.z >= 0 && pos.z < (i32)depth;
+    if (in_x && in_z) {
+        // the masks hold a layer past the faces, further out is air
+        if (pos.y < (i32)masks.y_start || pos.y >= (i32)masks.y_end) {
+            return false;
+        }
+        return FaceMasks::test(masks.opaque[masks.row(pos.y, pos.z)], pos.x);
     }
-    // check bottom face, y - 1
-    if (y == 0 || !blocks[get_index(x, y - 1, z)].is_active()) {
-        directions.push_back(Direction::bottom);
+    // one block past a side the border is known, past a corner it isn't
+    if (in_z) {
+        const Direction side = pos.x < 0 ? Direction::left : Direction::right;
+        return border_opaque(side, pos.y, pos.z);
+    }
+    if (in_x) {
+        const Direction side =
+            pos.z < 0 ? Direction::backward : Direction::forward;
+        return border_opaque(side, pos.y, pos.x);
+    }
+    return false;
+}
+
+// face_ao() of each set of opaque blocks around the air block in front of a
+// face, bit 3 * (v + 1) + u + 1 is set if the block at (u, v) is opaque
+constexpr static std::array<u8, 512> ao_table = []() {
+    std::array<u8, 512> table{};
+    for (u32 blocks = 0; blocks < table.size(); ++blocks) {
+        const auto at = [blocks](i32 u, i32 v) {
+            return (blocks >> (3 * (v + 1) + u + 1)) & 1;
+        };
+        u8 ao = 0;
+        for (u32 corner = 0; corner < 4; ++corner) {
+            const i32 u = corner & 1 ? 1 : -1, v = corner & 2 ? 1 : -1;
+            const u32 a = at(u, 0), b = at(0, v);
+            // two sides already close the corner off whatever is diagonal
+            const u32 level = a & b ? 3 : a + b + at(u, v);
+            ao |= level << (corner * 2);
+        }
+        table[blocks] = ao;
+    }
+    return table;
+}();
+
+u32 Chunk::opaque_run(const FaceMasks &masks,
+                      const omega::math::ivec3 &pos) const {
+    if (pos.y < 0 || pos.y >= (i32)height) return 0;
+    const u32 x = pos.x;
+    if (pos.z < 0 || pos.z >= (i32)depth) {
+        // past a corner is unknown
+        const Direction side =
+            pos.z < 0 ? Direction::backward : Direction::forward;
+        return (x > 0 && border_opaque(side, pos.y, x - 1)) |
+               (u32)border_opaque(side, pos.y, x) << 1 |
+               (u32)(x + 1 < width && border_opaque(side, pos.y, x + 1)) << 2;
+    }
+    // the masks hold a layer past the faces, further out is air
+    static const FaceMasks::Row air{};
+    const bool in_masks =
+        pos.y >= (i32)masks.y_start && pos.y < (i32)masks.y_end;
+    const FaceMasks::Row &row =
+        in_masks ? masks.opaque[masks.row(pos.y, pos.z)] : air;
+    const bool before = x > 0 ? FaceMasks::test(row, x - 1)
+                              : border_opaque(Direction::left, pos.y, pos.z);
+    const bool after = x + 1 < width
+                           ? FaceMasks::test(row, x + 1)
+                           : border_opaque(Direction::right, pos.y, pos.z);
+    return (u32)before | (u32)FaceMasks::test(row, x) << 1 | (u32)after << 2;
+}
+
+u8 Chunk::face_ao(const FaceMasks &masks,
+                  const omega::math::ivec3 &pos,
+                  u8 d) const {
+    // the air block in front of the face and the blocks around it
+    const omega::math::ivec3 front = pos + face_normals[d];
+    const u8 u = face_axes[d][1], v = face_axes[d][2];
+    u32 blocks = 0;
+    omega::math::ivec3 p = front;
+    if (u == 0) {
+        // three blocks of a row at a time
+        for (i32 dv = -1; dv <= 1; ++dv) {
+            p[v] = front[v] + dv;
+            blocks |= opaque_run(masks, p) << (3 * (dv + 1));
+        }
+        return ao_table[blocks];
+    }
+    for (i32 dv = -1; dv <= 1; ++dv) {
+        p[v] = front[v] + dv;
+        for (i32 du = -1; du <= 1; ++du) {
+            p[u] = front[u] + du;
+            blocks |= (u32)occludes(masks, p) << (3 * (dv + 1) + du + 1);
+        }
+    }
+    return ao_table[blocks];
+}
+
+void Chunk::load_naive_mesh(const FaceMasks &masks,
+                            std::vector<Quad> &quads) const {
+    // one quad for every visible face
+    for (u8 d = 0; d < 6; ++d) {
+        for (size_t y = masks.face_start; y < masks.face_end; ++y) {
+            for (size_t z = 0; z < depth; ++z) {
+                const FaceMasks::Row &row = masks.faces[d][masks.row(y, z)];
+                for (u32 w = 0; w < FaceMasks::words; ++w) {
+                    u64 bits = row[w];
+                    while (bits != 0) {
+                        const size_t x = w * 64 + std::countr_zero(bits);
+                        bits &= bits - 1;
+                        const omega::math::ivec3 pos(x, y, z);
+                        create_quad(pos,
+                                    1,
+                                    1,
+                                    get_block(x, y, z),
+                                    get_state(x, y, z),
+                                    quads,
+                                    (Direction)d,
+                                    face_ao(masks, pos, d));
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Merges the faces of a slice into rectangles, first along u then as many
+ * whole rows along v as possible, and calls emit(a, b, w, h, face) for each
+ * mask holds 0 where there is no face and is cleared as it goes
+ */
+template <typename Emit>
+static void merge_slice(std::vector<u32> &mask,
+                        u32 u_size,
+                        u32 v_size,
+                        u32 max_height,
+                        Emit &&emit) {
+    for (u32 b = 0; b < v_size; ++b) {
+        for (u32 a = 0; a < u_size;) {
+            const u32 face = mask[b * u_size + a];
+            if (face == 0) {
+                ++a;
+                continue;
+            }
+            // quads store their size in a few bits so cap it
+            u32 w = 1;
+            while (a + w < u_size && w < max_quad_extent &&
+                   mask[b * u_size + a + w] == face) {
+                ++w;
+            }
+            u32 h = 1;
+            for (; b + h < v_size && h < max_height; ++h) {
+                const u32 *row = &mask[(b + h) * u_size + a];
+                if (!std::all_of(
+                        row, row + w, [face](u32 f) { return f == face; })) {
+                    break;
+                }
+            }
+            for (u32 k = 0; k < h; ++k) {
+                std::fill_n(&mask[(b + k) * u_size + a], w, 0u);
+            }
+            emit(a, b, w, h, face);
+            a += w;
+        }
+    }
+}
+
+void Chunk::load_greedy_mesh(const FaceMasks &masks,
+                             std::vector<Quad> &quads) const {
+    constexpr u32 dimens[3] = {width, height, depth};
+    // visible faces of a slice through the chunk, 0 where there is no face
+    // otherwise the block type with the orientation in the upper bits
+    static thread_local std::vector<u32> mask;
+
+    for (u8 d = 0; d < 6; ++d) {
+        const u8 n = face_axes[d][0], u = face_axes[d][1], v = face_axes[d][2];
+        const std::vector<FaceMasks::Row> &faces = masks.faces[d];
+        // only the occupied band can have faces
+        const u32 n_start = n == 1 ? masks.face_start : 0;
+        const u32 n_end = n == 1 ? masks.face_end : dimens[n];
+        const u32 v_start = v == 1 ? masks.face_start : 0;
+        const u32 v_end = v == 1 ? masks.face_end : dimens[v];
+        const u32 u_size = dimens[u];
+        const u32 v_size = v_end - v_start;
+        mask.resize(u_size * v_size);
+
+        for (u32 i = n_start; i < n_end; ++i) {
+            // gather the visible faces in this slice
+            bool any = false;
+            std::fill(mask.begin(), mask.end(), 0u);
+            size_t p[3];
+            p[n] = i;
+            const auto add_face = [&](u32 b, u32 a) {
+                const BlockType type = get_block(p[0], p[1], p[2]);
+                const BlockState state = get_state(p[0], p[1], p[2]);
+                const u8 ao =
+                    face_ao(masks, omega::math::ivec3(p[0], p[1], p[2]), d);
+                // faces only merge if their corners are shaded the same
+                mask[b * u_size + a] = (u32)type |
+                                       ((u32)state.orientation << 16) |
+                                       ((u32)ao << 18);
+                any = true;
+            };
+            for (u32 b = 0; b < v_size; ++b) {
+                p[v] = b + v_start;
+                if (u != 0) {
+                    for (u32 a = 0; a < u_size; ++a) {
+                        p[u] = a;
+                        const size_t r = masks.row(p[1], p[2]);
+                        if (FaceMasks::test(faces[r], p[0])) add_face(b, a);
+                    }
+                    continue;
+                }
+                // rows run along x so walk their set bits
+                const FaceMasks::Row &row = faces[masks.row(p[1], p[2])];
+                for (u32 w = 0; w < FaceMasks::words; ++w) {
+                    u64 bits = row[w];
+                    while (bits != 0) {
+                        p[0] = w * 64 + std::countr_zero(bits);
+                        bits &= bits - 1;
+                        add_face(b, p[0]);
+                    }
+                }
+            }
+            if (!any) continue;
+
+            merge_slice(mask,
+                        u_size,
+                        v_size,
+                        max_quad_extent,
+                        [&](u32 a, u32 b, u32 w, u32 h, u32 face) {
+                            omega::math::ivec3 pos;
+                            pos[n] = i;
+                            pos[u] = a;
+                            pos[v] = b + v_start;
+                            const BlockState state{
+                                .orientation = (u8)((face >> 16) & 0x3)};
+                            create_quad(pos,
+                                        w,
+                                        h,
+                                        (BlockType)(face & 0xFFFF),
+                                        state,
+                                        quads,
+                                        (Direction)d,
+                                        (u8)(face >> 18));
+                        });
+        }
+    }
+}
+
+void Chunk::upload_mesh() {
+    // the built mesh becomes the one being drawn and patched
+    ranges = built_ranges;
+    mesh_lod = built_lod;
+    // send all quads to the GPU
+    if (mesh == nullptr) {
+        mesh = mesh_pool().acquire();
+    }
+    mesh->upload(built_quads.data(), sizeof(Quad) * built_quads.size());
+    num_quads = built_quads.size();
+    upload_commands();
+    // remeshing only needs the ranges, the quads aren't kept
+    release_staging();
+}
+
+void Chunk::upload_commands() {
+    static thread_local std::vector<DrawCommand> commands;
+    commands.clear();
+    for (u8 d = 0; d < 6; ++d) {
+        draws[d].first = commands.size();
+        for (const SectionRange &range : ranges[d]) {
+            if (range.count == 0) continue;
+            commands.push_back(DrawCommand{.instances = range.count,
+                                           .base_instance = range.offset});
+        }
+        draws[d].count = commands.size() - draws[d].first;
+    }
+    mesh->set_commands(commands.data(), commands.size());
+}
+
+void Chunk::release_staging() {
+    if (built_quads.capacity() == 0) return;
+    built_quads.clear();
+    quad_pool().release(std::move(built_quads));
+    built_quads = std::vector<Quad>();
+}
+
+void Chunk::load_lod_mesh(u32 level, std::vector<Quad> &quads) const {
+    const u32 scale = 1u << level;
+    // cubes on the far edges are cut short by the chunk, the shader clamps
+    // their corners to the chunk
+    const u32 cw = (width + scale - 1) / scale;
+    const u32 cd = (depth + scale - 1) / scale;
+    const u32 ch = (max_y + scale - 1) / scale;
+    static thread_local std::vector<BlockType> cubes;
+    cubes.assign(cw * ch * cd, BlockType::NONE);
+    const auto cube_idx = [&](u32 cx, u32 cy, u32 cz) {
+        return (cy * cd + cz) * cw + cx;
+    };
+
+    // 1. merge the blocks, going up a layer at a time so the last block
+    // written to a cube is its highest
+    for (u32 y = min_y; y < max_y; ++y) {
+        if (section_empty(y)) {
+            y |= section_height - 1;
+            continue;
+        }
+        for (u32 z = 0; z < depth; ++z) {
+            for (u32 x = 0; x < width; ++x) {
+                if (y >= column_height(x, z)) continue;
+                const BlockType type = get_block(x, y, z);
+                if (!block_info(type).solid) continue;
+                cubes[cube_idx(x / scale, y / scale, z / scale)] = type;
+            }
+        }
+    }
+
+    // true if the neighbour's blocks cover the whole side of a cube
+    const auto border_covered = [&](Direction side, u32 a, u32 cy) {
+        const u32 across = side <= Direction::right ? depth : width;
+        const u32 a_end = std::min((a + 1) * scale, across);
+        const u32 y_end = std::min((cy + 1) * scale, height);
+        for (u32 y = cy * scale; y < y_end; ++y) {
+            for (u32 i = a * scale; i < a_end; ++i) {
+                if (!border_opaque(side, y, i)) return false;
+            }
+        }
+        return true;
+    };
+
+    // 2. gather the visible cube faces a slice at a time and merge them like
+    // load_greedy_mesh(), blocks keep their default orientation
+    // marks side faces on the chunk's edges that hang a cube lower
+    constexpr u32 skirt_bit = 1u << 31;
+    const u32 dimens[3] = {cw, ch, cd};
+    static thread_local std::vector<u32> mask;
+
+    for (u8 d = 0; d < 6; ++d) {
+        const u8 n = face_axes[d][0], u = face_axes[d][1], v = face_axes[d][2];
+        const Direction dir = (Direction)d;
+        const u32 u_size = dimens[u], v_size = dimens[v];
+        mask.resize(u_size * v_size);
+
+        for (u32 i = 0; i < dimens[n]; ++i) {
+            bool any = false;
+            std::fill(mask.begin(), mask.end(), 0u);
+            omega::math::ivec3 p;
+            p[n] = i;
+            for (u32 b = 0; b < v_size; ++b) {
+                p[v] = b;
+                for (u32 a = 0; a < u_size; ++a) {
+                    p[u] = a;
+                    const BlockType type = cubes[cube_idx(p.x, p.y, p.z)];
+                    if (type == BlockType::NONE) continue;
+                    const omega::math::ivec3 q = p + face_normals[d];
+                    u32 face = (u32)type;
+                    if (q.y < 0) {
+                        continue; // nothing sees under the world
+                    } else if (q.y >= (i32)ch) {
+                        // open sky
+                    } else if (q.x >= 0 && q.x < (i32)cw && q.z >= 0 &&
+                               q.z < (i32)cd) {
+                        if (face_hidden(type, cubes[cube_idx(q.x, q.y, q.z)])) {
+                            continue;
+                        }
+                    } else {
+                        // on the chunk's side, the neighbour may be meshed
+                        // at another level so the face hangs a cube lower as
+                        // a skirt covering any gap between the two
+                        const u32 across = dir <= Direction::right ? p.z : p.x;
+                        if (border_covered(dir, across, p.y)) continue;
+                        face |= skirt_bit;
+                    }
+                    mask[b * u_size + a] = face;
+                    any = true;
+                }
+            }
+            if (!any) continue;
+
+            // one row is kept spare for the skirt
+            merge_slice(mask,
+                        u_size,
+                        v_size,
+                        max_quad_extent - 1,
+                        [&](u32 a, u32 b, u32 w, u32 h, u32 face) {
+                            omega::math::ivec3 pos;
+                            pos[n] = i;
+                            pos[u] = a;
+                            pos[v] = b;
+                            if ((face & skirt_bit) && b > 0) {
+                                --pos[v];
+                                ++h;
+                            }
+                            create_quad(pos,
+                                        w,
+                                        h,
+                                        (BlockType)(face & 0xFFFF),
+                                        {},
+                                        quads,
+                                        dir);
+                        });
+        }
     }
 }
@@ -1,11 +1,21 @@
 #ifndef VOXEL_ENTITY_CHUNK_H
 #define VOXEL_ENTITY_CHUNK_H
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <bitset>
+#include <utility>
+
 #include "omega/core/core.hpp"
 #include "omega/gfx/gfx.hpp"
 #include "omega/scene/scene.hpp"
 #include "omega/util/util.hpp"
 #include "voxel/entity/block.hpp"
+#include "voxel/util/palette.hpp"
+#include "voxel/util/pool.hpp"
+#include "voxel/util/worker_pool.hpp"
+#include "voxel/util/worldgen.hpp"
 
 enum class Direction : uint8_t {
     left = 0,
@@ -16,28 +26,107 @@ enum class Direction : uint8_t {
     bottom = 5
 };
 
+// chunk dimensions can be overridden at build time, see CMakeLists.txt
+#ifndef VOXEL_CHUNK_WIDTH
+#define VOXEL_CHUNK_WIDTH 15
+#endif
+#ifndef VOXEL_CHUNK_DEPTH
+#define VOXEL_CHUNK_DEPTH 15
+#endif
+#ifndef VOXEL_CHUNK_HEIGHT
+#define VOXEL_CHUNK_HEIGHT 255
+#endif
+
 /**
- * [0-4) -> x             2^4 = 15 + 1
- * [4-12) -> y            2^8 = 255 + 1
- * [12-16) -> z           2^4 = 15 + 1
- * [16-19) -> normal      2^3 > 6
- * [19-22) -> tex coord x 2^3 > 4 + 1
- * [22-25) -> tex coord y 2^3 > 4 + 1
+ * One record per quad, drawn instanced and expanded into two triangles in the
+ * vertex shader from gl_VertexID, 8 bytes per face instead of 6 vertices
+ * position of the quad's lowest corner
+ * [0-10) -> x            2^10 = 1023 + 1
+ * [10-22) -> y           2^12 = 4095 + 1
+ * [22-32) -> z           2^10 = 1023 + 1
+ * data
+ * [0-3) -> normal        2^3 > 6
+ * [3-5) -> orientation   quarter turns of the texture
+ * [5-9) -> width - 1     blocks along the face's first axis
+ * [9-13) -> height - 1   blocks along the face's second axis
+ * [13-24) -> atlas tile  2^11
+ * [24-32) -> ambient occlusion, 2 bits per corner, see Chunk::face_ao()
+ * texture coordinates are worked out from the position in the shader
  */
-
-struct Vertex {
+struct Quad {
+    uint32_t position;
     uint32_t data;
 };
 
-using Quad = std::array<Vertex, 6>;
+// fills the spare room in the mesh, the shaders collapse it to nothing
+constexpr static Quad empty_quad = {0, 0x7};
+
+// one draw of glMultiDrawArraysIndirect(), laid out the way GL reads it
+struct DrawCommand {
+    u32 vertices = 6; // two triangles per quad
+    u32 instances = 0;
+    u32 first_vertex = 0;
+    u32 base_instance = 0;
+};
+
+constexpr static uint32_t vertex_x_bits = 10;
+constexpr static uint32_t vertex_y_bits = 12;
+constexpr static uint32_t vertex_z_bits = 10;
+// greedy meshing can't merge more than this many blocks along either axis
+constexpr static uint32_t max_quad_extent = 16;
+constexpr static uint32_t quad_tile_bits = 11;
+
+/**
+ * naive -> one quad per visible block face
+ * greedy -> neighbouring faces with the same block and state are merged into
+ *           larger quads, far fewer vertices for the same surface
+ */
+enum class MeshMode : u8 { naive, greedy };
+
+// bit rows of a chunk's visible faces, see chunk.cpp
+struct FaceMasks;
+
+/**
+ * GL objects holding a chunk's mesh
+ * These are recycled between chunks so streaming doesn't keep creating new
+ * vertex arrays/buffers
+ */
+struct ChunkMesh {
+    ChunkMesh();
+    ~ChunkMesh();
+    void upload(const void *data, size_t size);
+    // overwrites part of the uploaded data
+    void update(size_t offset, const void *data, size_t size);
+    // replaces the draw commands render() submits
+    void set_commands(const DrawCommand *data, size_t count);
+
+    omega::util::uptr<omega::gfx::VertexArray> vao = nullptr;
+    omega::util::uptr<omega::gfx::VertexBuffer> vbo = nullptr;
+    // GL_DRAW_INDIRECT_BUFFER holding the DrawCommands
+    GLuint commands = 0;
+};
 
 class Chunk {
   public:
-    Chunk(const omega::math::vec3 &position);
+    /**
+     * Generates and meshes the chunk straight away
+     * A deferred chunk is left empty, call generate() and build_mesh() (on
+     * any thread) and then upload_mesh() on the main thread
+     */
+    Chunk(const omega::math::vec3 &position, bool deferred = false);
     ~Chunk();
 
-    void render(float dt);
-    void init_block(size_t x, size_t y, size_t z, int8_t type);
+    /**
+     * Draws the chunk's faces in the directions set in faces, one bit per
+     * Direction, see faces_toward() and faces_along()
+     */
+    void render(float dt, u8 faces = all_faces);
+    constexpr static u8 all_faces = 0x3F;
+    // directions of the faces that can be seen from eye
+    u8 faces_toward(const omega::math::vec3 &eye) const;
+    // directions of the faces that can be seen looking along view_dir, for
+    // orthographic views like the sun's
+    static u8 faces_along(const omega::math::vec3 &view_dir);
 
     const omega::math::vec3 &get_position() const {
         return position;
@@ -46,51 +135,319 @@ class Chunk {
         this->position = position;
     }
 
-    constexpr static uint32_t width = 15;   // x axis
-    constexpr static uint32_t depth = 15;   // z axis
-    constexpr static uint32_t height = 255; // y axis
+    constexpr static uint32_t width = VOXEL_CHUNK_WIDTH;   // x axis
+    constexpr static uint32_t depth = VOXEL_CHUNK_DEPTH;   // z axis
+    constexpr static uint32_t height = VOXEL_CHUNK_HEIGHT; // y axis
     constexpr static omega::math::vec3 dimens = {width, height, depth};
     constexpr static size_t max_cubes = width * depth * height;
+    // vertices sit on block corners so the far edge has to fit as well
+    static_assert(width < (1u << vertex_x_bits), "chunk too wide");
+    static_assert(height < (1u << vertex_y_bits), "chunk too high");
+    static_assert(depth < (1u << vertex_z_bits), "chunk too deep");
+
+    // the chunk is split vertically into sections of 16 blocks
+    constexpr static uint32_t section_shift = 4;
+    constexpr static uint32_t section_height = 1 << section_shift;
+    constexpr static uint32_t num_sections =
+        (height + section_height - 1) / section_height;
+    constexpr static size_t section_cubes = width * depth * section_height;
+
+    BlockType get_block(size_t x, size_t y, size_t z) const {
+        const Section &section = sections[y >> section_shift];
+        if (section.uniform) return section.type;
+        return section.blocks[get_index(x, y, z)].type;
+    }
+
+    bool block_active(size_t x, size_t y, size_t z) const {
+        return block_info(get_block(x, y, z)).solid;
+    }
+
+    // true if the section containing y is all air
+    bool section_empty(size_t y) const {
+        const Section &section = sections[y >> section_shift];
+        return section.uniform && section.type == BlockType::NONE;
+    }
+
+    // one past the highest block in the column, 0 if it's empty
+    u32 column_height(size_t x, size_t z) const {
+        return heightmap[z * width + x];
+    }
 
-    bool block_active(size_t x, size_t y, size_t z) {
-        return blocks[get_index(x, y, z)].is_active();
+    // every block in the chunk sits in [min_y, max_y)
+    u32 get_min_y() const {
+        return min_y;
+    }
+    u32 get_max_y() const {
+        return max_y;
+    }
+
+    BlockState get_state(size_t x, size_t y, size_t z) const {
+        if (states.empty()) return BlockState{};
+        auto it = states.find(state_key(x, y, z));
+        return it == states.end() ? BlockState{} : it->second;
+    }
+    void set_state(size_t x, size_t y, size_t z, BlockState state);
+
+    /**
+     * Copies which blocks of the neighbouring chunk's touching layer are
+     * opaque so the faces on that side can be culled, nullptr treats the
+     * side as air, side must be left, right, forward or backward
+     * The chunk only remeshes on the next remesh_dirty(), see needs_remesh()
+     */
+    void set_neighbor(Direction side, const Chunk *neighbor);
+    // a block or border changed since the mesh was built
+    bool needs_remesh() const {
+        return dirty.any();
+    }
+    // every section has to be remeshed, usually after a border changed
+    bool needs_rebuild() const {
+        return dirty.all();
+    }
+    // true once after a block on the chunk's sides was edited, its
+    // neighbours have to be given the new border
+    bool take_border_edit() {
+        return std::exchange(border_edited, false);
+    }
+    // a block was changed since the chunk was generated, an unedited chunk
+    // can be dropped and generated again from the world seed
+    bool is_edited() const {
+        return edited;
     }
 
     void remove_block(size_t x, size_t y, size_t z);
-    void add_block(size_t x, size_t y, size_t z, int8_t type);
+    void add_block(size_t x,
+                   size_t y,
+                   size_t z,
+                   BlockType type,
+                   BlockState state = {});
+    // rebuilds the whole mesh
     void update_chunk();
+    // safe to call for several chunks on different threads at once
+    void generate();
+    // generates the deferred chunks spread over every core, returns once
+    // they're all done
+    static void generate_batch(const std::vector<Chunk *> &chunks,
+                               WorkerPool &workers);
+    /**
+     * Samples the noise for the smallest block of chunks holding all of the
+     * neighbouring chunks once, generate(region) then fills each of them
+     */
+    static void sample_region(const std::vector<Chunk *> &chunks,
+                              WorldGen::Region &region);
+    // generate() from a region holding the chunk, comes out the same and is
+    // as safe to call on different threads at once
+    void generate(const WorldGen::Region &region);
+    // set_neighbor() for every pair of the chunks that share a side
+    static void link_region(const std::vector<Chunk *> &chunks);
+    // meshes the chunk into a CPU side buffer, doesn't touch any GL objects
+    // so it can run on a worker thread as long as nothing edits the chunk
+    void build_mesh();
+    // sends the last mesh built to the GPU, the chunk only draws after this
+    void upload_mesh();
+    // only remeshes the sections touched by edits since the last remesh and
+    // patches them into the mesh in place
+    void remesh_dirty();
+
+    /**
+     * Packs the blocks into a palette and frees the expanded array
+     * Blocks can't be read or edited until decompress() is called
+     */
+    void compress();
+    void decompress();
+    bool is_compressed() const {
+        return compressed;
+    }
+    // heap memory used by the compressed blocks
+    size_t compressed_size() const;
+
+    // hands the GL objects and mesh data back to the pools, call
+    // update_chunk() to mesh it again
+    void release_mesh();
+
+    // size of the uploaded mesh, it isn't kept in system memory
+    size_t mesh_bytes() const {
+        return num_quads * sizeof(Quad);
+    }
+
+    size_t quad_count() const {
+        size_t count = 0;
+        for (const auto &bucket : ranges) {
+            for (const SectionRange &range : bucket) {
+                count += range.count;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Distant chunks are meshed from cubes of 2^lod blocks merged together,
+     * a cube is solid if any block in it is and takes the type of its
+     * highest block so the coarse surface never sits below the real one
+     * Takes effect on the next rebuild, setting a new level marks the whole
+     * chunk dirty
+     */
+    void set_lod(u32 level);
+    u32 get_lod() const {
+        return lod;
+    }
+    // cubes no wider than the chunk, a wider one would cover the whole
+    // chunk with a single clamped column
+    constexpr static u32 max_lod =
+        std::min(3u, (u32)std::bit_width(std::min(width, depth)) - 1);
+    // size of a cube in the drawn mesh
+    f32 lod_scale() const {
+        return (f32)(1u << mesh_lod);
+    }
+
+    // how chunks build their meshes, existing meshes keep their mode until
+    // update_chunk() is called
+    static inline std::atomic<MeshMode> mesh_mode = MeshMode::greedy;
+
+    struct PoolStats {
+        size_t sections = 0;
+        size_t meshes = 0;
+        size_t quad_buffers = 0;
+    };
+    // number of free objects sitting in each pool
+    static PoolStats pool_stats();
+    // frees everything in the pools, must be called while the GL context is
+    // still alive
+    static void clear_pools();
 
   private:
     constexpr static uint32_t num_vertices = 36; // vertices per cube
 
+    /**
+     * A 16 high slice of the chunk
+     * If every block in the section is the same type (usually all air above
+     * the terrain or all stone below it) only the type is stored and the
+     * section is skipped by meshing and collisions
+     */
+    struct Section {
+        bool uniform = true;
+        BlockType type = BlockType::NONE;
+        omega::util::uptr<Block[]> blocks = nullptr;
+        PaletteStorage packed;
+    };
+
+    // index of a block inside its section, stored in horizontal layers
     static size_t get_index(size_t x, size_t y, size_t z) {
-        return (z * width * height) + (y * width) + x;
+        return ((y & (section_height - 1)) * depth + z) * width + x;
     }
 
     static void get_xyz(size_t idx, size_t &x, size_t &y, size_t &z) {
-        z = idx / (width * height);
-        idx -= (z * width * height);
-        y = idx / width;
+        y = idx / (width * depth);
+        idx -= (y * width * depth);
+        z = idx / width;
         x = idx % width;
     }
 
-    void gen_blocks();
-    void load_mesh();
+    void set_block(size_t x, size_t y, size_t z, BlockType type);
+    // splits freshly generated blocks, laid out (z * width * height) +
+    // (y * width) + x, into sections
+    void load_generated(const Block *blocks, u32 ground, u32 top);
+    void update_bounds(size_t x, size_t y, size_t z, BlockType type);
+    bool layer_empty(size_t y) const;
 
-    void get_face_directions(size_t x,
-                             size_t y,
-                             size_t z,
-                             std::vector<Direction> &directions);
+    void load_mesh();
+    // hands built_quads back to the pool
+    void release_staging();
+    void mesh_section(u32 s, FaceMasks &masks, std::vector<Quad> &quads) const;
+    void find_faces(FaceMasks &masks, u32 y_begin, u32 y_end) const;
+    void load_naive_mesh(const FaceMasks &masks,
+                         std::vector<Quad> &quads) const;
+    void load_greedy_mesh(const FaceMasks &masks,
+                          std::vector<Quad> &quads) const;
+    void load_lod_mesh(u32 level, std::vector<Quad> &quads) const;
+    /**
+     * Classic voxel ambient occlusion, each corner of the face at pos
+     * facing d is darkened by the opaque blocks touching it in front of the
+     * face, 0 (open) to 3 (closed in by both sides)
+     * 2 bits per corner, the corner at (u, v) along the face's axes is at
+     * bit 2 * (u + 2 * v)
+     */
+    u8 face_ao(const FaceMasks &masks,
+               const omega::math::ivec3 &pos,
+               u8 d) const;
+    // true if the block at pos, which can be one past the sides, is opaque
+    bool occludes(const FaceMasks &masks, const omega::math::ivec3 &pos) const;
+    // opaque bits of the blocks one before, at and one after pos along x
+    u32 opaque_run(const FaceMasks &masks,
+                   const omega::math::ivec3 &pos) const;
+    bool border_opaque(Direction side, u32 y, u32 i) const {
+        const BorderRow &row = borders[(u8)side][y];
+        return (row[i / 64] >> (i % 64)) & 1;
+    }
 
     // GL render settings
-    constexpr static uint32_t vertex_attr_count = 1; // data per vertex
-    omega::util::uptr<omega::gfx::VertexArray> vao = nullptr;
-    omega::util::uptr<omega::gfx::VertexBuffer> vbo = nullptr;
+    constexpr static uint32_t vertex_attr_count = 2; // data per quad
+    omega::util::uptr<ChunkMesh> mesh = nullptr;
     // block data
-    Block *blocks = nullptr;
-    size_t vbo_offset = 0;
+    std::array<Section, num_sections> sections;
+    // one past the highest block of each column, indexed z * width + x
+    std::array<u16, width * depth> heightmap{};
+    u32 min_y = 0, max_y = 0;
+    // every block below solid_y is opaque, meshing doesn't need to read them
+    u32 solid_y = 0;
+    // sparse state of the few blocks that have any
+    BlockStates states;
+    // opaque blocks in the neighbouring layer past each side, indexed by
+    // Direction then y, bit z for left/right and bit x for forward/backward
+    constexpr static uint32_t border_words =
+        (std::max(width, depth) + 63) / 64;
+    using BorderRow = std::array<u64, border_words>;
+    std::array<std::array<BorderRow, height>, 4> borders{};
+    bool border_edited = false;
+    bool edited = false;
+    /**
+     * Where each section's quads sit in the mesh
+     * Every section with quads keeps some empty_quad padding after them so
+     * it can usually be remeshed without moving the others, only count is
+     * drawn
+     */
+    struct SectionRange {
+        u32 offset = 0;
+        u32 count = 0;
+        u32 capacity = 0;
+    };
+    /**
+     * The mesh is laid out a Direction at a time so render() can skip every
+     * face pointing away from the camera a direction at a time, indexed by
+     * Direction then section
+     * Coarse meshes keep each direction's quads in its first section
+     */
+    using MeshRanges = std::array<std::array<SectionRange, num_sections>, 6>;
+    MeshRanges ranges{};
+    // a direction's DrawCommands, one per range with quads
+    struct DrawRange {
+        u32 first = 0;
+        u32 count = 0;
+    };
+    std::array<DrawRange, 6> draws{};
+    // sends a DrawCommand for every range with quads to the mesh
+    void upload_commands();
+    // sorts quads, meshed a section at a time and starting at sections, into
+    // each direction's ranges
+    static void layout_mesh(const std::vector<Quad> &quads,
+                            const std::array<u32, num_sections + 1> &sections,
+                            bool padded,
+                            std::vector<Quad> &mesh,
+                            MeshRanges &ranges);
+    // sections that have to be remeshed
+    std::bitset<num_sections> dirty;
+    bool compressed = false;
+    // quads in the uploaded mesh, padding included
+    size_t num_quads = 0;
     omega::math::vec3 position{0.0f};
-    std::vector<Quad> quads_to_add;
+    /**
+     * Mesh from build_mesh() waiting for upload_mesh()
+     * A staging buffer taken from a pool and handed back once it's
+     * uploaded, the drawn mesh is only kept on the GPU
+     */
+    std::vector<Quad> built_quads;
+    MeshRanges built_ranges{};
+    // level of detail wanted, of the built mesh and of the drawn mesh
+    u32 lod = 0, built_lod = 0, mesh_lod = 0;
 };
 
 #endif // VOXEL_ENTITY_CHUNK_H
@@ -57,9 +57,15 @@ void Player::handle_collisions(Chunk *chunk) {
     // clamp the values
     min_local = math::max(math::uvec3(0), min_local);
     max_local = math::min((math::uvec3)Chunk::dimens - 1u, max_local);
+    // nothing to collide with above the terrain
+    if (min_local.y >= chunk->get_max_y()) return;
     for (u32 z = min_local.z; z <= max_local.z; ++z) {
-        for (u32 y = min_local.y; z <= max_local.y; ++y) {
-            for (u32 x = min_local.x; z <= max_local.x; ++x) {
+        for (u32 x = min_local.x; x <= max_local.x; ++x) {
+            // only check up to the top of the column
+            u32 top = math::min(max_local.y + 1, chunk->column_height(x, z));
+            for (u32 y = min_local.y; y < top; ++y) {
+                // nothing to collide with in an empty section
+                if (chunk->section_empty(y)) continue;
                 auto active = chunk->block_active(x, y, z);
                 if (!active) continue;
                 // there must be a collision here
@@ -1,8 +1,10 @@
 #ifndef VOXEL_UTIL_BIOME_HPP
 #define VOXEL_UTIL_BIOME_HPP
 
+#include <algorithm>
 #include <functional>
 #include <numeric>
+#include <vector>
 
 #include "omega/math/bezier.hpp"
 #include "omega/util/log.hpp"
@@ -65,36 +67,135 @@ struct Biome {
     omega::math::Range<f32> height;
 };
 
-struct BiomeManager {
-    std::vector<Biome> biomes;
-    std::vector<f32> weights;
-
+/**
+ * Picks the biome of a column from its temperature, humidity and height
+ *
+ * Alongside the exact computation it keeps lookup tables baked over the
+ * [0, 1] range of the inputs, rebuilt by set_biomes()
+ * The blended height only depends on temperature and humidity, it's
+ * interpolated from a 2D table. The best biome comes from a 3D table of
+ * cells, a cell whose corners disagree falls back to the exact search
+ * The lookup only approximates the exact search, a border that passes
+ * between a cell's corners or a biome small enough to fit inside a cell
+ * isn't seen, measure_lut() reports how often that happens
+ */
+class BiomeManager {
+  public:
     struct BiomeInfo {
         f32 height;
         const Biome *biome;
     };
 
-    BiomeInfo compute_biome(f32 t, f32 hu, f32 h) {
+    const std::vector<Biome> &get_biomes() const {
+        return biomes;
+    }
+
+    // not thread safe, rebuilds the lookup tables
+    void set_biomes(std::vector<Biome> biomes) {
+        this->biomes = std::move(biomes);
+        build_lut();
+    }
+
+    // safe to call from several threads at once
+    BiomeInfo compute_biome(f32 t, f32 hu, f32 h) const {
+        BiomeInfo info;
+        info.height = blended_height(t, hu);
+        info.biome = best_biome(t, hu, h);
+        return info;
+    }
+
+    // compute_biome() through the lookup tables, close to it but not exact
+    BiomeInfo lookup_biome(f32 t, f32 hu, f32 h) const {
+        // the tables only cover [0, 1]
+        if (!(in_unit(t) && in_unit(hu) && in_unit(h))) {
+            return compute_biome(t, hu, h);
+        }
+        BiomeInfo info;
+        // blended height, bilinear between the corners of the cell
+        constexpr u32 hn = height_lut_size;
+        const f32 ft = t * hn, fh = hu * hn;
+        const u32 ht = omega::math::min((u32)ft, hn - 1);
+        const u32 hh = omega::math::min((u32)fh, hn - 1);
+        const f32 *corner = &height_lut[hh * (hn + 1) + ht];
+        info.height = omega::math::lerp(
+            omega::math::lerp(corner[0], corner[1], ft - ht),
+            omega::math::lerp(corner[hn + 1], corner[hn + 2], ft - ht),
+            fh - hh);
+        // best biome
+        constexpr u32 n = lut_size;
+        const u32 it = omega::math::min((u32)(t * n), n - 1);
+        const u32 ih = omega::math::min((u32)(hu * n), n - 1);
+        const u32 ie = omega::math::min((u32)(h * n), n - 1);
+        const u8 best = biome_lut[(ie * n + ih) * n + it];
+        info.biome = best == border ? best_biome(t, hu, h) : &biomes[best];
+        return info;
+    }
+
+    // how far lookup_biome() is from compute_biome()
+    struct LutAccuracy {
+        f32 biome_mismatch = 0.0f; // fraction of points with another biome
+        f32 border_cells = 0.0f;   // fraction of cells searched exactly
+        f32 mean_height_error = 0.0f;
+        f32 max_height_error = 0.0f;
+    };
+
+    /**
+     * Compares the lookup against the exact path at steps^3 points spread
+     * over [0, 1]^3, offset from the table's grid
+     */
+    LutAccuracy measure_lut(u32 steps) const {
+        LutAccuracy acc;
+        u32 mismatches = 0;
+        f64 height_error = 0.0;
+        for (u32 k = 0; k < steps; ++k) {
+            for (u32 j = 0; j < steps; ++j) {
+                for (u32 i = 0; i < steps; ++i) {
+                    const f32 t = (i + 0.37f) / steps;
+                    const f32 hu = (j + 0.61f) / steps;
+                    const f32 h = (k + 0.19f) / steps;
+                    BiomeInfo exact = compute_biome(t, hu, h);
+                    BiomeInfo lut = lookup_biome(t, hu, h);
+                    mismatches += exact.biome != lut.biome;
+                    f32 error = omega::math::abs(exact.height - lut.height);
+                    height_error += error;
+                    acc.max_height_error =
+                        omega::math::max(acc.max_height_error, error);
+                }
+            }
+        }
+        const f64 count = (f64)steps * steps * steps;
+        acc.biome_mismatch = (f32)(mismatches / count);
+        acc.mean_height_error = (f32)(height_error / count);
+        acc.border_cells =
+            (f32)std::count(biome_lut.begin(), biome_lut.end(), border) /
+            biome_lut.size();
+        return acc;
+    }
+
+  private:
+    // cells per axis of the tables, the height one is 2D so it can afford
+    // more of them
+    static constexpr u32 lut_size = 32;
+    static constexpr u32 height_lut_size = 128;
+    // biome_lut entry of a cell with more than one biome, also taken by
+    // every biome past the first 255
+    static constexpr u8 border = 0xFF;
+
+    static bool in_unit(f32 v) {
+        return v >= 0.0f && v <= 1.0f;
+    }
+
+    f32 blended_height(f32 t, f32 hu) const {
         // create a weighted average, so each biome gives a weight
         // the higher the weight, the more the point is like this biome
-        f32 min_dist = 100.0f;
         f32 sum = 0.0f;
+        static thread_local std::vector<f32> weights;
         weights.clear();
-
-        const Biome *best_biome = nullptr;
-
         for (const auto &biome : biomes) {
-            f32 weight = biome.distance(t, hu, h);
+            // the height doesn't weigh in
+            f32 weight = biome.distance(t, hu, 0.0f);
             weights.push_back(weight);
             sum += weight;
-
-            f32 dist = biome.param_dist(t, biome.temperature) * 6.0f +
-                       biome.param_dist(hu, biome.humidity) * 4.0f +
-                       biome.param_dist(h, biome.height) * 8.0f;
-            if (dist < min_dist) {
-                min_dist = dist;
-                best_biome = &biome;
-            }
         }
         // normalize the weights
         f32 blended_height = 0.0f;
@@ -104,12 +205,78 @@ struct BiomeManager {
             weight /= sum;
             blended_height += weight * height.average();
         }
+        return blended_height;
+    }
 
-        BiomeInfo info;
-        info.height = blended_height;
-        info.biome = best_biome;
-        return info;
+    const Biome *best_biome(f32 t, f32 hu, f32 h) const {
+        f32 min_dist = 100.0f;
+        const Biome *best_biome = nullptr;
+        for (const auto &biome : biomes) {
+            f32 dist = biome.param_dist(t, biome.temperature) * 6.0f +
+                       biome.param_dist(hu, biome.humidity) * 4.0f +
+                       biome.param_dist(h, biome.height) * 8.0f;
+            if (dist < min_dist) {
+                min_dist = dist;
+                best_biome = &biome;
+            }
+        }
+        return best_biome;
     }
+
+    void build_lut() {
+        constexpr u32 hn = height_lut_size + 1;
+        height_lut.resize(hn * hn);
+        for (u32 j = 0; j < hn; ++j) {
+            for (u32 i = 0; i < hn; ++i) {
+                height_lut[j * hn + i] = blended_height(
+                    (f32)i / height_lut_size, (f32)j / height_lut_size);
+            }
+        }
+        constexpr u32 n = lut_size + 1; // grid points per axis
+        // best biome at every grid point
+        std::vector<u8> points(n * n * n);
+        for (u32 k = 0; k < n; ++k) {
+            for (u32 j = 0; j < n; ++j) {
+                for (u32 i = 0; i < n; ++i) {
+                    const Biome *best = best_biome((f32)i / lut_size,
+                                                   (f32)j / lut_size,
+                                                   (f32)k / lut_size);
+                    u8 point = border;
+                    if (best != nullptr && best - biomes.data() < border) {
+                        point = (u8)(best - biomes.data());
+                    }
+                    points[(k * n + j) * n + i] = point;
+                }
+            }
+        }
+        // a cell takes its corners' biome when they all agree, whatever lies
+        // between the corners
+        biome_lut.resize(lut_size * lut_size * lut_size);
+        for (u32 k = 0; k < lut_size; ++k) {
+            for (u32 j = 0; j < lut_size; ++j) {
+                for (u32 i = 0; i < lut_size; ++i) {
+                    const u8 first = points[(k * n + j) * n + i];
+                    u8 cell = first;
+                    for (u32 c = 1; c < 8; ++c) {
+                        const u32 x = i + (c & 1), y = j + ((c >> 1) & 1),
+                                  z = k + (c >> 2);
+                        if (points[(z * n + y) * n + x] != first) {
+                            cell = border;
+                        }
+                    }
+                    biome_lut[(k * lut_size + j) * lut_size + i] = cell;
+                }
+            }
+        }
+    }
+
+    std::vector<Biome> biomes;
+    // blended height at the (height_lut_size + 1)^2 grid points, indexed
+    // humidity * (height_lut_size + 1) + temperature
+    std::vector<f32> height_lut;
+    // best biome index of each cell, indexed (height * lut_size +
+    // humidity) * lut_size + temperature
+    std::vector<u8> biome_lut;
 };
 
 #endif // VOXEL_UTIL_BIOME_HPP
@@ -0,0 +1,103 @@
+#ifndef VOXEL_UTIL_PALETTE_HPP
+#define VOXEL_UTIL_PALETTE_HPP
+
+#include <vector>
+
+#include "omega/util/types.hpp"
+#include "voxel/entity/block.hpp"
+
+/**
+ * Compressed block storage for chunks that are not being rendered
+ *
+ * Keeps a palette of the distinct block types in the chunk and packs each
+ * block as an index into the palette using the fewest bits possible,
+ * a chunk of only air/stone/dirt/grass takes 2 bits per block
+ * A single type chunk takes no index bits at all
+ */
+class PaletteStorage {
+  public:
+    void pack(const Block *blocks, size_t count) {
+        // build the palette, it's small enough to search linearly
+        palette.clear();
+        indices.resize(count);
+        u16 last = 0;
+        for (size_t i = 0; i < count; ++i) {
+            BlockType type = blocks[i].type;
+            // runs of the same block are common
+            if (palette.empty() || palette[last] != type) {
+                last = 0;
+                while (last < palette.size() && palette[last] != type) {
+                    ++last;
+                }
+                if (last == palette.size()) {
+                    palette.push_back(type);
+                }
+            }
+            indices[i] = last;
+        }
+        palette.shrink_to_fit();
+
+        bits_per_block = 0;
+        while ((1u << bits_per_block) < palette.size()) {
+            ++bits_per_block;
+        }
+        this->count = count;
+
+        // indices never straddle two words
+        if (bits_per_block == 0) {
+            words = std::vector<u64>();
+            return;
+        }
+        const size_t per_word = 64 / bits_per_block;
+        words = std::vector<u64>((count + per_word - 1) / per_word, 0);
+        for (size_t i = 0; i < count; ++i) {
+            words[i / per_word] |= (u64)indices[i]
+                                   << ((i % per_word) * bits_per_block);
+        }
+    }
+
+    void unpack(Block *blocks) const {
+        if (bits_per_block == 0) {
+            BlockType type = palette.empty() ? BlockType::NONE : palette[0];
+            for (size_t i = 0; i < count; ++i) {
+                blocks[i].type = type;
+            }
+            return;
+        }
+        const size_t per_word = 64 / bits_per_block;
+        const u64 mask = (1ull << bits_per_block) - 1;
+        for (size_t i = 0; i < count; ++i) {
+            u64 palette_idx =
+                (words[i / per_word] >> ((i % per_word) * bits_per_block)) &
+                mask;
+            blocks[i].type = palette[palette_idx];
+        }
+    }
+
+    void clear() {
+        palette = std::vector<BlockType>();
+        words = std::vector<u64>();
+        bits_per_block = 0;
+        count = 0;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    // heap memory used by the packed data
+    size_t size_bytes() const {
+        return palette.capacity() * sizeof(BlockType) +
+               words.capacity() * sizeof(u64);
+    }
+
+  private:
+    std::vector<BlockType> palette;
+    std::vector<u64> words;
+    u32 bits_per_block = 0;
+    size_t count = 0;
+    // palette index of each block while packing, kept to avoid reallocating
+    static inline thread_local std::vector<u16> indices;
+};
+
+#endif // VOXEL_UTIL_PALETTE_HPP
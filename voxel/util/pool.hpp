@@ -0,0 +1,59 @@
+#ifndef VOXEL_UTIL_POOL_HPP
+#define VOXEL_UTIL_POOL_HPP
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+ * Free list of recycled objects
+ *
+ * Holds on to at most high_water released objects, anything released past
+ * that is destroyed so the pool's memory stays bounded
+ * Safe to share between threads
+ */
+template <typename T>
+class Pool {
+  public:
+    Pool(size_t high_water, std::function<T()> create)
+        : high_water(high_water), create(std::move(create)) {
+        free.reserve(high_water);
+    }
+
+    T acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!free.empty()) {
+                T obj = std::move(free.back());
+                free.pop_back();
+                return obj;
+            }
+        }
+        return create();
+    }
+
+    void release(T &&obj) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (free.size() < high_water) {
+            free.push_back(std::move(obj));
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        free.clear();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return free.size();
+    }
+
+  private:
+    std::vector<T> free;
+    size_t high_water = 0;
+    std::function<T()> create;
+    std::mutex mutex;
+};
+
+#endif // VOXEL_UTIL_POOL_HPP
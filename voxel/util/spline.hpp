@@ -0,0 +1,65 @@
+#ifndef VOXEL_UTIL_SPLINE_HPP
+#define VOXEL_UTIL_SPLINE_HPP
+
+#include <array>
+#include <utility>
+
+#include "omega/util/types.hpp"
+
+/**
+ * Piecewise linear curve through points sorted by x, defined at compile
+ * time
+ */
+template <size_t N>
+struct Spline {
+    static_assert(N >= 2, "a spline needs at least two points");
+
+    std::array<std::pair<f32, f32>, N> points;
+
+    // linear search for the segment holding x, meant for baking tables
+    constexpr f32 operator()(f32 x) const {
+        size_t i = 0;
+        for (; i < N - 2; ++i) {
+            if (points[i].first <= x && x <= points[i + 1].first) {
+                break;
+            }
+        }
+        const auto &[x0, y0] = points[i];
+        const auto &[x1, y1] = points[i + 1];
+        return y0 + (y1 - y0) * ((x - x0) / (x1 - x0));
+    }
+};
+
+/**
+ * A curve over [0, 1] resampled at Size + 1 evenly spaced points
+ * Evaluating it is an index and a lerp, no search and no branches past the
+ * clamp, so it also runs over whole arrays at once
+ */
+template <u32 Size>
+class SplineLut {
+  public:
+    template <size_t N>
+    constexpr explicit SplineLut(const Spline<N> &spline) {
+        for (u32 i = 0; i <= Size; ++i) {
+            values[i] = spline((f32)i / (f32)Size);
+        }
+    }
+
+    constexpr f32 operator()(f32 x) const {
+        x = x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+        const f32 f = x * (f32)Size;
+        const u32 i = (u32)f < Size - 1 ? (u32)f : Size - 1;
+        return values[i] + (values[i + 1] - values[i]) * (f - (f32)i);
+    }
+
+    void operator()(const f32 *x, f32 *out, u32 count) const {
+        for (u32 i = 0; i < count; ++i) {
+            out[i] = (*this)(x[i]);
+        }
+    }
+
+  private:
+    std::array<f32, Size + 1> values{};
+};
+
+#endif // VOXEL_UTIL_SPLINE_HPP
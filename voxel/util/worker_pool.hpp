@@ -0,0 +1,115 @@
+#ifndef VOXEL_UTIL_WORKER_POOL_HPP
+#define VOXEL_UTIL_WORKER_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "omega/util/types.hpp"
+
+/**
+ * Fixed set of threads running queued jobs in the order they were submitted
+ * Jobs still waiting when the pool is destroyed are dropped, the ones
+ * already running are finished first
+ */
+class WorkerPool {
+  public:
+    explicit WorkerPool(u32 count = default_count()) {
+        for (u32 i = 0; i < count; ++i) {
+            threads.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            jobs.clear();
+        }
+        wake.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+    /**
+     * Calls fn(i) for every i in [0, count) spread over the workers and the
+     * calling thread, returns once every call has finished
+     * Mustn't be called from one of the pool's jobs, it could end up
+     * waiting on itself
+     */
+    void parallel_for(u32 count, const std::function<void(u32)> &fn) {
+        std::atomic<u32> next = 0;
+        const auto work = [&]() {
+            for (u32 i = next++; i < count; i = next++) {
+                fn(i);
+            }
+        };
+        // the caller takes a share as well
+        const u32 helpers = std::min((u32)threads.size(), count - (count > 0));
+        std::latch finished(helpers);
+        for (u32 i = 0; i < helpers; ++i) {
+            submit([&]() {
+                work();
+                finished.count_down();
+            });
+        }
+        work();
+        finished.wait();
+    }
+
+    // jobs that haven't started yet
+    size_t pending() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return jobs.size();
+    }
+
+    size_t size() const {
+        return threads.size();
+    }
+
+    // leaves a core for the main thread
+    static u32 default_count() {
+        return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+  private:
+    void run() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif // VOXEL_UTIL_WORKER_POOL_HPP
@@ -6,12 +6,21 @@
 #include "noise/perlin_noise.h"
 #include "omega/math/bezier.hpp"
 #include "omega/math/glm.hpp"
+#include "omega/util/log.hpp"
 #include "omega/util/random.hpp"
 #include "omega/util/util.hpp"
 #include "voxel/entity/block.hpp"
 #include "voxel/entity/water.hpp"
 #include "voxel/util/biome.hpp"
-
+#include "voxel/util/spline.hpp"
+
+/**
+ * Terrain generator shared by every chunk
+ * Everything it holds is set up once in the constructor and only read after
+ * that, gen() can run on any number of threads at once
+ * What gen() makes only depends on the world seed and the chunk position,
+ * a chunk can be thrown away and generated again block for block
+ */
 class WorldGen {
   public:
     WorldGen(const WorldGen &) = delete;
@@ -25,96 +34,211 @@ class WorldGen {
         return i.get();
     }
 
-    f32 get_height(f32 x, f32 y) {
-        // continental
-        f32 c = get_continental(x, y) * 0.5f + 0.5f;
-        c = omega::math::clamp(c, 0.0f, 1.0f);
-        f32 c_height = get_height_from_points(cont, c);
-        // peaks and valleys
-        f32 p = get_peaks_valleys(x, y) * 0.5f + 0.5f;
-        p = omega::math::clamp(p, 0.0f, 1.0f);
-        f32 p_height = get_height_from_points(pv, p);
-        // erosion
-        f32 e = get_erosion(x, y) * 0.5f + 0.5f;
-        e = omega::math::clamp(e, 0.0f, 1.0f);
-        f32 e_height = get_height_from_points(ero, e);
-
-        // combining 3 layers of fbm with spline based
-        // mountains/valleys/plateaus
-        f32 w1 = 1.6f, w2 = 1.8f, w3 = 1.8f;
-        f32 w4 = 0.2f, w5 = 0.5f, w6 = 0.3f;
-        f32 combined = (c * w1 + e * w2 + p * w3 + c_height * w4 +
-                        e_height * w5 + p_height * w6) /
-                       (w1 + w2 + w3 + w4 + w5 + w6);
-        return combined;
+    u32 get_seed() const {
+        return seed;
+    }
+
+    // not thread safe, chunks generated under different seeds won't line up
+    void set_seed(u32 seed) {
+        this->seed = seed;
+        Noise *layers[] = {&peaks_valleys,
+                           &continentalness,
+                           &erosion,
+                           &height_change,
+                           &temperature,
+                           &humidity};
+        for (u64 i = 0; i < std::size(layers); ++i) {
+            layers[i]->reseed((u32)mix((u64)seed << 8 | i));
+        }
+    }
+
+    /**
+     * Spacing in blocks of the lattice each noise field is sampled on, the
+     * columns in between are interpolated, 1 samples every column
+     * The lattice is fixed to the world so neighbouring chunks line up
+     */
+    struct SampleRates {
+        u32 continental = 4;
+        u32 peaks_valleys = 4;
+        u32 erosion = 16;
+        u32 climate = 8; // temperature and humidity
+        u32 height_change = 2;
+    };
+
+    const SampleRates &get_sample_rates() const {
+        return rates;
+    }
+
+    // not thread safe, change the rates only while no chunk is generating
+    void set_sample_rates(const SampleRates &rates) {
+        this->rates = rates;
+    }
+
+    f32 get_height_change(f32 x, f32 y, f32 factor) const {
+        return height_change.noise2D(x * factor, y * factor);
     }
 
-    f32 get_height_change(f32 x, f32 y, f32 factor) {
-        return height_change().noise2D(x * factor, y * factor);
+    // vertical extent of the generated blocks
+    struct Bounds {
+        u32 ground = 0; // every block below ground is solid
+        u32 top = 0;    // one past the highest block
+    };
+
+    /**
+     * What a block of neighbouring chunks have in common, sampled in one go
+     * so chunks generated together share one set of batched noise calls and
+     * the lattice points along their edges
+     */
+    struct Region {
+        omega::math::vec3 pos; // corner chunk with the lowest x and z
+        u32 chunks_x = 0, chunks_z = 0;
+        u32 w = 0, d = 0; // chunk size in blocks
+        // per column, indexed z * chunks_x * w + x
+        std::vector<f32> height, temp, humid;
+        std::vector<f32> change; // get_height_change() at a factor of 0.05
+        std::vector<u8> tree;    // rolled a tree, it grows if above water
+    };
+
+    // samples the chunks_x * chunks_z chunks of size w * d from pos on
+    void sample_region(Region &region,
+                       omega::math::vec3 pos,
+                       u32 chunks_x,
+                       u32 chunks_z,
+                       u32 w,
+                       u32 d) const {
+        region.pos = pos;
+        region.chunks_x = chunks_x;
+        region.chunks_z = chunks_z;
+        region.w = w;
+        region.d = d;
+        const u32 region_w = chunks_x * w, region_d = chunks_z * d;
+        sample_columns(region,
+                       Tile{(i32)pos.x * (i32)w,
+                            (i32)pos.z * (i32)d,
+                            region_w,
+                            region_d});
+        // plan the trees, rolled per chunk so a chunk generated on its own
+        // gets the same ones
+        region.tree.resize(region_w * region_d);
+        for (u32 cz = 0; cz < chunks_z; ++cz) {
+            for (u32 cx = 0; cx < chunks_x; ++cx) {
+                const u64 key = chunk_key(pos + omega::math::vec3(cx, 0, cz));
+                for (u32 z = 0; z < d; ++z) {
+                    for (u32 x = 0; x < w; ++x) {
+                        region.tree[(cz * d + z) * region_w + cx * w + x] =
+                            random(key, tree_stream | (z * w + x), 0, 200) ==
+                            10;
+                    }
+                }
+            }
+        }
     }
 
-    void gen(Block *blocks, omega::math::vec3 pos, u32 w, u32 d, u32 h) {
-        using omega::math::min, omega::math::map_range, omega::util::random;
+    /**
+     * Fills blocks (w * d * h) with terrain and writes one past the highest
+     * block of each column to heightmap (w * d, indexed z * w + x)
+     * Blocks that need extra state get an entry in states
+     */
+    Bounds gen(Block *blocks,
+               u16 *heightmap,
+               BlockStates &states,
+               omega::math::vec3 pos,
+               u32 w,
+               u32 d,
+               u32 h) const {
+        static thread_local Region region;
+        sample_region(region, pos, 1, 1, w, d);
+        return gen(region, blocks, heightmap, states, pos, h);
+    }
+
+    // gen() for the chunk at pos inside an already sampled region
+    Bounds gen(const Region &region,
+               Block *blocks,
+               u16 *heightmap,
+               BlockStates &states,
+               omega::math::vec3 pos,
+               u32 h) const {
+        using omega::math::min, omega::math::map_range;
+        const u32 w = region.w, d = region.d;
+        // where the chunk's columns start in the region's
+        const u32 stride = region.chunks_x * w;
+        const u32 first = (u32)(pos.z - region.pos.z) * d * stride +
+                          (u32)(pos.x - region.pos.x) * w;
+        std::fill(heightmap, heightmap + w * d, 0);
+        Bounds bounds{.ground = h, .top = 0};
         const auto idx = [&w, &d, &h](u32 x, u32 y, u32 z) {
             return (z * w * h) + (y * w) + x;
         };
+        const auto raise_column = [&](u32 x, u32 z, u32 top) {
+            u16 &column = heightmap[z * w + x];
+            column = (u16)omega::math::max((u32)column, min(top, h));
+        };
+        // decorations draw from counters keyed on the chunk, so they don't
+        // depend on which thread generates it or what it generated before
+        // the trees are rolled by sample_region()
+        const u64 key = chunk_key(pos);
         const auto add_leaf = [&](int x, int y, int z) {
             if (x < 0 || x > (int)w - 1) return;
             if (y < 0 || y > (int)h - 1) return;
             if (z < 0 || z > (int)d - 1) return;
             blocks[idx(x, y, z)].type = BlockType::LEAF;
+            raise_column(x, z, y + 1);
+            // turn leaves randomly to break up the texture
+            u8 orientation =
+                (u8)random(key, leaf_stream | idx(x, y, z), 0, 3);
+            if (orientation != 0) {
+                states[state_key(x, y, z)] =
+                    BlockState{.orientation = orientation};
+            }
         };
 
         const auto add_tree = [&](u32 x, u32 y, u32 z) {
-            if (omega::util::random<i32>(0, 200) == 10 && y > Water::height) {
-                u32 h = y;
-                for (; y < h + 5; ++y) {
+            if (region.tree[first + z * stride + x] && y > Water::height) {
+                const u32 base = y;
+                // the trunk is cut short by the top of the chunk, like the
+                // leaves
+                for (; y < min(base + 5, h); ++y) {
                     blocks[idx(x, y, z)].type = BlockType::TREE_TRUNK;
                 }
+                raise_column(x, z, y);
                 // add leaves
                 // x axis
-                add_leaf((int)x - 1, (int)h + 4, (int)z);
-                add_leaf((int)x - 2, (int)h + 4, (int)z);
-                add_leaf((int)x + 1, (int)h + 4, (int)z);
-                add_leaf((int)x + 2, (int)h + 4, (int)z);
+                add_leaf((int)x - 1, (int)base + 4, (int)z);
+                add_leaf((int)x - 2, (int)base + 4, (int)z);
+                add_leaf((int)x + 1, (int)base + 4, (int)z);
+                add_leaf((int)x + 2, (int)base + 4, (int)z);
 
-                add_leaf((int)x + 1, (int)h + 3, (int)z);
-                add_leaf((int)x - 1, (int)h + 3, (int)z);
+                add_leaf((int)x + 1, (int)base + 3, (int)z);
+                add_leaf((int)x - 1, (int)base + 3, (int)z);
                 // z axis
-                add_leaf((int)x, (int)h + 4, (int)z - 1);
-                add_leaf((int)x, (int)h + 4, (int)z - 2);
-                add_leaf((int)x, (int)h + 4, (int)z + 1);
-                add_leaf((int)x, (int)h + 4, (int)z + 2);
+                add_leaf((int)x, (int)base + 4, (int)z - 1);
+                add_leaf((int)x, (int)base + 4, (int)z - 2);
+                add_leaf((int)x, (int)base + 4, (int)z + 1);
+                add_leaf((int)x, (int)base + 4, (int)z + 2);
 
-                add_leaf((int)x, (int)h + 3, (int)z + 1);
-                add_leaf((int)x, (int)h + 3, (int)z - 1);
+                add_leaf((int)x, (int)base + 3, (int)z + 1);
+                add_leaf((int)x, (int)base + 3, (int)z - 1);
                 // diagonal
-                add_leaf((int)x + 1, (int)h + 4, (int)z + 1);
-                add_leaf((int)x - 1, (int)h + 4, (int)z + 1);
-                add_leaf((int)x + 1, (int)h + 4, (int)z - 1);
-                add_leaf((int)x - 1, (int)h + 4, (int)z - 1);
+                add_leaf((int)x + 1, (int)base + 4, (int)z + 1);
+                add_leaf((int)x - 1, (int)base + 4, (int)z + 1);
+                add_leaf((int)x + 1, (int)base + 4, (int)z - 1);
+                add_leaf((int)x - 1, (int)base + 4, (int)z - 1);
                 // y axis
-                add_leaf((int)x, (int)h + 5, (int)z);
+                add_leaf((int)x, (int)base + 5, (int)z);
             }
         };
         for (u32 z = 0; z < d; ++z) {
             for (u32 x = 0; x < w; ++x) {
                 f32 x_w = pos.x * (f32)w + x;
                 f32 z_w = pos.z * (f32)d + z;
+                const u32 column = first + z * stride + x;
                 // set base layer
                 blocks[idx(x, 0, z)].type = BlockType::STONE;
 
-                // sample height
-                f32 f = 0.85f;
-                f32 base_height = get_height(x_w * f, z_w * f);
+                f32 base_height = region.height[column];
                 // generate biome type
-                f = 0.005f; // temperature & humidity frequency modifier
-                f32 temp =
-                    temperature().octave2D(x_w * f, z_w * f, 4, 0.5f) * 0.5f +
-                    0.5f;
-                f32 humid =
-                    humidity().octave2D(x_w * f, z_w * f, 4, 0.7f) * 0.5f +
-                    0.5f;
+                f32 temp = region.temp[column] * 0.5f + 0.5f;
+                f32 humid = region.humid[column] * 0.5f + 0.5f;
                 // modify temperature depending on height
                 f32 sign = omega::math::sign(base_height - 0.5f);
                 temp -=
@@ -123,7 +247,7 @@ class WorldGen {
 
                 // get biome type and weighted height
                 BiomeManager::BiomeInfo info =
-                    bm.compute_biome(temp, humid, base_height);
+                    bm.lookup_biome(temp, humid, base_height);
 
                 // calculate final height
                 f32 height;
@@ -133,11 +257,11 @@ class WorldGen {
                     -90.0f,
                     300.0f,
                     base_height * 0.85f + info.height * 0.15f);
-                height = omega::math::clamp(height, 0.0f, 255.0f);
+                height = omega::math::clamp(height, 0.0f, (f32)h);
 
                 // place sand blocks
-                f32 sand_height = Water::height + 4.0f +
-                                  3.0f * get_height_change(x_w, z_w, 0.05f);
+                f32 sand_height =
+                    Water::height + 4.0f + 3.0f * region.change[column];
                 u32 y = 1;
                 for (; y < min(sand_height, height); ++y) {
                     blocks[idx(x, y, z)].type = BlockType::SAND;
@@ -145,8 +269,7 @@ class WorldGen {
                 switch (info.biome->biome) {
                     case BiomeType::SNOWY_MOUNTAINS: {
                         f32 stone_height =
-                            height - 5.0f -
-                            3.0f * get_height_change(x_w, z_w, 0.05f);
+                            height - 5.0f - 3.0f * region.change[column];
                         for (; y < stone_height; ++y) {
                             blocks[idx(x, y, z)].type = BlockType::STONE;
                         }
@@ -257,167 +380,378 @@ class WorldGen {
                     default:
                         break;
                 }
+                // trees only add blocks above the ground
+                bounds.ground = min(bounds.ground, y);
+                raise_column(x, z, y);
             }
         }
+        for (u32 i = 0; i < w * d; ++i) {
+            bounds.top = omega::math::max(bounds.top, (u32)heightmap[i]);
+        }
+        return bounds;
     }
 
   private:
     using Noise = siv::BasicPerlinNoise<f32>;
 
-    static Noise get_noise_function() {
-        siv::PerlinNoise::seed_type seed = omega::util::random<u32>(0, 1000000);
-        return siv::BasicPerlinNoise<f32>{seed};
+    // splitmix64's finalizer, every input bit flips about half the output
+    static constexpr u64 mix(u64 v) {
+        v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9ull;
+        v = (v ^ (v >> 27)) * 0x94d049bb133111ebull;
+        return v ^ (v >> 31);
     }
 
-    Noise &peaks_valleys() {
-        static Noise noise = get_noise_function();
-        return noise;
+    // decoration rolls of a chunk, different for every seed and position
+    u64 chunk_key(omega::math::vec3 pos) const {
+        const u64 x = (u32)(i32)pos.x, z = (u32)(i32)pos.z;
+        return mix(mix(seed) ^ (x | z << 32));
     }
 
-    Noise &continentalness() {
-        static Noise noise = get_noise_function();
-        return noise;
+    // counters of each kind of roll, or'd with a block or column index
+    static constexpr u64 tree_stream = 1ull << 32;
+    static constexpr u64 leaf_stream = 2ull << 32;
+
+    /**
+     * Counter based random number in [min, max], the same key and counter
+     * always give the same number whatever order they're drawn in
+     */
+    static i32 random(u64 key, u64 counter, i32 min, i32 max) {
+        const u64 bits = mix(key ^ mix(counter));
+        return min + (i32)((bits >> 32) % (u64)(max - min + 1));
     }
 
-    Noise &erosion() {
-        static Noise noise = get_noise_function();
-        return noise;
+    // columns of the world in blocks, from (x0, z0) on
+    struct Tile {
+        i32 x0, z0;
+        u32 w, d;
+    };
+
+    // the noise every column of the tile needs
+    void sample_columns(Region &region, const Tile &tile) const {
+        static thread_local std::vector<f32> c, p, e;
+        const u32 w = tile.w, d = tile.d;
+        for (std::vector<f32> *v : {&region.height, &region.temp,
+                                    &region.humid, &region.change, &c, &p,
+                                    &e}) {
+            v->resize(w * d);
+        }
+        sample_field(tile,
+                     rates.continental,
+                     c.data(),
+                     [this](const f32 *x, const f32 *z, f32 *out, u32 n) {
+                         Points h = height_points(x, z, n);
+                         get_continental(h.x, h.y, out, n);
+                     });
+        sample_field(tile,
+                     rates.peaks_valleys,
+                     p.data(),
+                     [this](const f32 *x, const f32 *z, f32 *out, u32 n) {
+                         Points h = height_points(x, z, n);
+                         get_peaks_valleys(h.x, h.y, out, n);
+                     });
+        sample_field(tile,
+                     rates.erosion,
+                     e.data(),
+                     [this](const f32 *x, const f32 *z, f32 *out, u32 n) {
+                         Points h = height_points(x, z, n);
+                         get_erosion(h.x, h.y, out, n);
+                     });
+        // the splines aren't linear, interpolate the noise rather than
+        // the height it's shaped into
+        shape_heights(c.data(),
+                      p.data(),
+                      e.data(),
+                      region.height.data(),
+                      w * d);
+        // temperature & humidity frequency modifier
+        sample_field(tile,
+                     rates.climate,
+                     region.temp.data(),
+                     [this](const f32 *x, const f32 *z, f32 *out, u32 n) {
+                         Points f = scale_points(x, z, 0.005f, n);
+                         temperature.octave2DBatch(f.x, f.y, out, n, 4, 0.5f);
+                     });
+        sample_field(tile,
+                     rates.climate,
+                     region.humid.data(),
+                     [this](const f32 *x, const f32 *z, f32 *out, u32 n) {
+                         Points f = scale_points(x, z, 0.005f, n);
+                         humidity.octave2DBatch(f.x, f.y, out, n, 4, 0.7f);
+                     });
+        sample_field(tile,
+                     rates.height_change,
+                     region.change.data(),
+                     [this](const f32 *x, const f32 *z, f32 *out, u32 n) {
+                         Points f = scale_points(x, z, 0.05f, n);
+                         height_change.noise2DBatch(f.x, f.y, out, n);
+                     });
     }
 
-    Noise &height_change() {
-        static Noise noise = get_noise_function();
-        return noise;
+    static i32 floor_div(i32 a, i32 b) {
+        return a / b - (a % b != 0 && (a < 0) != (b < 0));
+    }
+
+    /**
+     * Writes a noise field to out (w * d) for every column of the tile
+     * eval(x, z, out, count) evaluates the field at count world positions
+     * Above a rate of 1 it's only evaluated on the lattice and the columns
+     * are interpolated bilinearly
+     */
+    template <typename Eval>
+    static void sample_field(const Tile &tile,
+                             u32 rate,
+                             f32 *out,
+                             const Eval &eval) {
+        static thread_local std::vector<f32> xs, zs, values;
+        const u32 w = tile.w, d = tile.d;
+        if (rate <= 1) {
+            xs.resize(w * d);
+            zs.resize(w * d);
+            for (u32 z = 0; z < d; ++z) {
+                for (u32 x = 0; x < w; ++x) {
+                    xs[z * w + x] = (f32)(tile.x0 + (i32)x);
+                    zs[z * w + x] = (f32)(tile.z0 + (i32)z);
+                }
+            }
+            eval(xs.data(), zs.data(), out, w * d);
+            return;
+        }
+        const i32 r = (i32)rate;
+        const i32 x0 = tile.x0, z0 = tile.z0;
+        // lattice cells covering the tile, plus the far corner of the last
+        const i32 cx = floor_div(x0, r), cz = floor_div(z0, r);
+        const u32 nx = floor_div(x0 + (i32)w - 1, r) - cx + 2;
+        const u32 nz = floor_div(z0 + (i32)d - 1, r) - cz + 2;
+        xs.resize(nx * nz);
+        zs.resize(nx * nz);
+        values.resize(nx * nz);
+        for (u32 j = 0; j < nz; ++j) {
+            for (u32 i = 0; i < nx; ++i) {
+                xs[j * nx + i] = (f32)((cx + (i32)i) * r);
+                zs[j * nx + i] = (f32)((cz + (i32)j) * r);
+            }
+        }
+        eval(xs.data(), zs.data(), values.data(), nx * nz);
+        for (u32 z = 0; z < d; ++z) {
+            const i32 wz = z0 + (i32)z;
+            const u32 j = floor_div(wz, r) - cz;
+            const f32 tz = (f32)(wz - (cz + (i32)j) * r) / (f32)r;
+            for (u32 x = 0; x < w; ++x) {
+                const i32 wx = x0 + (i32)x;
+                const u32 i = floor_div(wx, r) - cx;
+                const f32 tx = (f32)(wx - (cx + (i32)i) * r) / (f32)r;
+                const f32 *v = &values[j * nx + i];
+                out[z * w + x] = omega::math::lerp(
+                    omega::math::lerp(v[0], v[1], tx),
+                    omega::math::lerp(v[nx], v[nx + 1], tx),
+                    tz);
+            }
+        }
     }
 
-    Noise &temperature() {
-        static Noise noise = get_noise_function();
-        return noise;
+    // points scaled by a noise layer's frequency
+    struct Points {
+        const f32 *x, *y;
+    };
+
+    /**
+     * (x[i] * factor, y[i] * factor) for every point, kept in per-thread
+     * scratch that the next call on the thread overwrites
+     */
+    static Points scale_points(const f32 *x,
+                               const f32 *y,
+                               f32 factor,
+                               u32 count) {
+        static thread_local std::vector<f32> sx, sy;
+        sx.resize(count);
+        sy.resize(count);
+        for (u32 i = 0; i < count; ++i) {
+            sx[i] = x[i] * factor;
+            sy[i] = y[i] * factor;
+        }
+        return Points{sx.data(), sy.data()};
     }
 
-    Noise &humidity() {
-        static Noise noise = get_noise_function();
-        return noise;
+    // where the height layers are sampled, 0.85 of the world position
+    // kept apart from scale_points() as the layers scale these again
+    static Points height_points(const f32 *x, const f32 *z, u32 count) {
+        static thread_local std::vector<f32> hx, hz;
+        hx.resize(count);
+        hz.resize(count);
+        for (u32 i = 0; i < count; ++i) {
+            hx[i] = x[i] * 0.85f;
+            hz[i] = z[i] * 0.85f;
+        }
+        return Points{hx.data(), hz.data()};
     }
 
-    f32 get_height_from_points(const std::vector<std::pair<f32, f32>> &values,
-                               f32 noise_val) {
-        size_t i = 0;
-        for (; i < values.size() - 1; ++i) {
-            if (values[i].first <= noise_val &&
-                noise_val <= values[i + 1].first) {
-                break;
-            }
+    /**
+     * Combines 3 layers of fbm with spline based mountains/valleys/plateaus
+     * c, p and e are the layers' noise in [-1, 1], they get remapped in place
+     */
+    void shape_heights(f32 *c, f32 *p, f32 *e, f32 *out, u32 count) const {
+        static thread_local std::vector<f32> c_height, p_height, e_height;
+        c_height.resize(count);
+        p_height.resize(count);
+        e_height.resize(count);
+        for (u32 i = 0; i < count; ++i) {
+            c[i] = omega::math::clamp(c[i] * 0.5f + 0.5f, 0.0f, 1.0f);
+            p[i] = omega::math::clamp(p[i] * 0.5f + 0.5f, 0.0f, 1.0f);
+            e[i] = omega::math::clamp(e[i] * 0.5f + 0.5f, 0.0f, 1.0f);
+        }
+        cont_lut(c, c_height.data(), count);
+        pv_lut(p, p_height.data(), count);
+        ero_lut(e, e_height.data(), count);
+
+        const f32 w1 = 1.6f, w2 = 1.8f, w3 = 1.8f;
+        const f32 w4 = 0.2f, w5 = 0.5f, w6 = 0.3f;
+        for (u32 i = 0; i < count; ++i) {
+            out[i] = (c[i] * w1 + e[i] * w2 + p[i] * w3 + c_height[i] * w4 +
+                      e_height[i] * w5 + p_height[i] * w6) /
+                     (w1 + w2 + w3 + w4 + w5 + w6);
         }
-        return omega::math::lerp(values[i].second,
-                                 values[i + 1].second,
-                                 (noise_val - values[i].first) /
-                                     (values[i + 1].first - values[i].first));
     }
 
-    f32 get_continental(f32 x, f32 y) {
+    void get_continental(const f32 *x,
+                         const f32 *y,
+                         f32 *out,
+                         u32 count) const {
         static constexpr f32 factor = 1.0f / 64.0f;
         static constexpr u32 octaves = 4;
         static constexpr f32 amplitude = 0.4f;
-        return continentalness().octave2D_11(
-            x * factor, y * factor, octaves, amplitude);
+        Points p = scale_points(x, y, factor, count);
+        continentalness.octave2D_11Batch(
+            p.x, p.y, out, count, octaves, amplitude);
     }
 
-    f32 get_peaks_valleys(f32 x, f32 y) {
+    void get_peaks_valleys(const f32 *x,
+                           const f32 *y,
+                           f32 *out,
+                           u32 count) const {
         static constexpr f32 factor = 1.0f / 256.0f;
         static constexpr u32 octaves = 6;
         static constexpr f32 amplitude = 0.5f;
-        return peaks_valleys().octave2D_11(
-            x * factor, y * factor, octaves, amplitude);
+        Points p = scale_points(x, y, factor, count);
+        peaks_valleys.octave2D_11Batch(
+            p.x, p.y, out, count, octaves, amplitude);
     }
 
-    f32 get_erosion(f32 x, f32 y) {
+    void get_erosion(const f32 *x, const f32 *y, f32 *out, u32 count) const {
         static constexpr f32 factor = 1.0f / 512.0f * 0.3f;
         static constexpr u32 octaves = 4;
-        f32 amplitude = 0.8f;
+        static constexpr f32 amplitude = 0.8f;
+        static thread_local std::vector<f32> amplitudes;
+        amplitudes.resize(count);
+        Points p = scale_points(x, y, factor, count);
         // extra erosion layer
-        if (erosion().noise2D(x * factor, y * factor) < 0.0f) {
-            amplitude /= 1.1f;
+        erosion.noise2DBatch(p.x, p.y, out, count);
+        for (u32 i = 0; i < count; ++i) {
+            amplitudes[i] = out[i] < 0.0f ? amplitude / 1.1f : amplitude;
         }
-        return erosion().octave2D_11(
-            x * factor, y * factor, octaves, amplitude);
+        erosion.octave2D_11Batch(
+            p.x, p.y, out, count, octaves, amplitudes.data());
     }
 
     WorldGen() {
-        // generate continental terrain points
-        cont.push_back({0.0f, 1.0f});
-        cont.push_back({0.08f, 1.0f});
-        cont.push_back({0.12f, 0.45f});
-        cont.push_back({0.16f, 0.43f});
-        cont.push_back({0.31f, 0.65f});
-        cont.push_back({0.36f, 0.65f});
-        cont.push_back({0.6f, 0.18f});
-        cont.push_back({0.63f, 0.2f});
-        cont.push_back({0.72f, 0.25f});
-        cont.push_back({0.88f, 0.55f});
-        cont.push_back({1.0f, 0.45f});
-
-        // generate erosion points
-        ero.push_back({0.0f, 0.567124f});
-        ero.push_back({0.1387f, 0.56807f});
-        ero.push_back({0.3246f, 0.45072f});
-        ero.push_back({0.6937f, 0.48783f});
-        ero.push_back({0.72f, 0.84f});
-        ero.push_back({0.84f, 0.82f});
-        ero.push_back({0.86f, 0.034f});
-        ero.push_back({0.9215f, 0.033f});
-        ero.push_back({1.0f, 0.019f});
-
-        // generate peaks and valleys points
-        pv.push_back({0.0f, 0.0f});
-        pv.push_back({0.16, 0.16f});
-        pv.push_back({0.37, 0.43f});
-        pv.push_back({0.47, 0.7f});
-        pv.push_back({0.56, 0.98f});
-        pv.push_back({0.73, 0.88});
-        pv.push_back({0.85, 0.7f});
-        pv.push_back({0.95, 0.64f});
-        pv.push_back({1.0f, 0.44f});
-
+        set_seed(omega::util::random<u32>(0, 1000000));
         // generate the biomes
         using rng = omega::math::Range<f32>;
-        bm.biomes.push_back(Biome{rng{0.0f, 0.3f},
-                                  rng{0.0f, 0.3f},
-                                  rng{0.7f, 1.0f},
-                                  BiomeType::SNOWY_MOUNTAINS});
-        bm.biomes.push_back(Biome{rng{0.4f, 0.8f},
-                                  rng{0.3f, 0.7f},
-                                  rng{0.3f, 0.5f},
-                                  BiomeType::FOREST});
-        bm.biomes.push_back(Biome{rng{0.0f, 0.4f},
-                                  rng{0.3f, 0.5f},
-                                  rng{0.3f, 0.6f},
-                                  BiomeType::PLAINS});
-        bm.biomes.push_back(Biome{rng{0.5f, 0.7f},
-                                  rng{0.0f, 0.3f},
-                                  rng{0.6f, 1.0f},
-                                  BiomeType::STONY_MOUNTAINS});
-        bm.biomes.push_back(Biome{rng{0.7f, 1.0f},
-                                  rng{0.0f, 0.3f},
-                                  rng{0.0f, 0.4f},
-                                  BiomeType::DESERT});
-        bm.biomes.push_back(Biome{rng{0.7f, 1.0f},
-                                  rng{0.7f, 1.0f},
-                                  rng{0.1f, 0.4f},
-                                  BiomeType::JUNGLE});
-        bm.biomes.push_back(Biome{rng{0.3f, 0.5f},
-                                  rng{0.0f, 0.3f},
-                                  rng{0.5f, 0.8f},
-                                  BiomeType::TUNDRA});
-        bm.biomes.push_back(Biome{rng{0.8f, 1.0f},
-                                  rng{0.3f, 0.7f},
-                                  rng{0.2f, 0.5f},
-                                  BiomeType::BADLANDS});
+        std::vector<Biome> biomes;
+        biomes.push_back(Biome{rng{0.0f, 0.3f},
+                               rng{0.0f, 0.3f},
+                               rng{0.7f, 1.0f},
+                               BiomeType::SNOWY_MOUNTAINS});
+        biomes.push_back(Biome{rng{0.4f, 0.8f},
+                               rng{0.3f, 0.7f},
+                               rng{0.3f, 0.5f},
+                               BiomeType::FOREST});
+        biomes.push_back(Biome{rng{0.0f, 0.4f},
+                               rng{0.3f, 0.5f},
+                               rng{0.3f, 0.6f},
+                               BiomeType::PLAINS});
+        biomes.push_back(Biome{rng{0.5f, 0.7f},
+                               rng{0.0f, 0.3f},
+                               rng{0.6f, 1.0f},
+                               BiomeType::STONY_MOUNTAINS});
+        biomes.push_back(Biome{rng{0.7f, 1.0f},
+                               rng{0.0f, 0.3f},
+                               rng{0.0f, 0.4f},
+                               BiomeType::DESERT});
+        biomes.push_back(Biome{rng{0.7f, 1.0f},
+                               rng{0.7f, 1.0f},
+                               rng{0.1f, 0.4f},
+                               BiomeType::JUNGLE});
+        biomes.push_back(Biome{rng{0.3f, 0.5f},
+                               rng{0.0f, 0.3f},
+                               rng{0.5f, 0.8f},
+                               BiomeType::TUNDRA});
+        biomes.push_back(Biome{rng{0.8f, 1.0f},
+                               rng{0.3f, 0.7f},
+                               rng{0.2f, 0.5f},
+                               BiomeType::BADLANDS});
+        bm.set_biomes(std::move(biomes));
+#ifdef VOXEL_CHECK_BIOME_LUT
+        // compares the tables with the exact search, see CMakeLists.txt
+        BiomeManager::LutAccuracy acc = bm.measure_lut(32);
+        omega::util::debug(
+            "biome lut: {}% of cells searched, {}% biomes differ, height "
+            "error mean {} max {}",
+            acc.border_cells * 100.0f,
+            acc.biome_mismatch * 100.0f,
+            acc.mean_height_error,
+            acc.max_height_error);
+#endif
     }
 
-    std::vector<std::pair<f32, f32>> cont; // continentalness (cliffs/plateaus)
-    std::vector<std::pair<f32, f32>> ero;  // erosion (flatness)
-    std::vector<std::pair<f32, f32>> pv;   // peaks and valleys
+    // seeded by set_seed(), evaluating them doesn't change anything
+    u32 seed = 0;
+    Noise peaks_valleys;
+    Noise continentalness;
+    Noise erosion;
+    Noise height_change;
+    Noise temperature;
+    Noise humidity;
+
+    // continentalness (cliffs/plateaus)
+    static constexpr Spline<11> cont{{{{0.0f, 1.0f},
+                                       {0.08f, 1.0f},
+                                       {0.12f, 0.45f},
+                                       {0.16f, 0.43f},
+                                       {0.31f, 0.65f},
+                                       {0.36f, 0.65f},
+                                       {0.6f, 0.18f},
+                                       {0.63f, 0.2f},
+                                       {0.72f, 0.25f},
+                                       {0.88f, 0.55f},
+                                       {1.0f, 0.45f}}}};
+    // erosion (flatness)
+    static constexpr Spline<9> ero{{{{0.0f, 0.567124f},
+                                     {0.1387f, 0.56807f},
+                                     {0.3246f, 0.45072f},
+                                     {0.6937f, 0.48783f},
+                                     {0.72f, 0.84f},
+                                     {0.84f, 0.82f},
+                                     {0.86f, 0.034f},
+                                     {0.9215f, 0.033f},
+                                     {1.0f, 0.019f}}}};
+    // peaks and valleys
+    static constexpr Spline<9> pv{{{{0.0f, 0.0f},
+                                    {0.16f, 0.16f},
+                                    {0.37f, 0.43f},
+                                    {0.47f, 0.7f},
+                                    {0.56f, 0.98f},
+                                    {0.73f, 0.88f},
+                                    {0.85f, 0.7f},
+                                    {0.95f, 0.64f},
+                                    {1.0f, 0.44f}}}};
+    // the curves baked at compile time, fine enough that the steepest
+    // segment of ero stays within a hundredth of the exact curve
+    static constexpr u32 spline_lut_size = 1024;
+    static constexpr SplineLut<spline_lut_size> cont_lut{cont};
+    static constexpr SplineLut<spline_lut_size> ero_lut{ero};
+    static constexpr SplineLut<spline_lut_size> pv_lut{pv};
     BiomeManager bm;
+    SampleRates rates;
 };
 
 #endif // VOXEL_UTIL_WORLDGEN_HPP
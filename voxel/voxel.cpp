@@ -1,3 +1,7 @@
+#include <atomic>
+#include <deque>
+#include <iterator>
+#include <mutex>
 #include <unordered_set>
 
 #include "imgui/imgui.h"
@@ -18,16 +22,39 @@
 #include "voxel/entity/player.hpp"
 #include "voxel/entity/sun.hpp"
 #include "voxel/entity/water.hpp"
+#include "voxel/util/worker_pool.hpp"
+#include "voxel/util/worldgen.hpp"
 
 using namespace omega;
 
+// view distance in blocks, see CMakeLists.txt
+#ifndef VOXEL_VIEW_DISTANCE
+#define VOXEL_VIEW_DISTANCE 150
+#endif
+
 constexpr static f32 fov = 70.0f;
-constexpr static f32 far = 150.0f;
+// chunks are loaded out to the far plane
+constexpr static f32 far = VOXEL_VIEW_DISTANCE;
 constexpr static f32 near = 1.0f;
+// distance from the player past which chunks drop to each level of detail
+constexpr static f32 lod_distances[] = {48.0f, 80.0f, 112.0f};
+static_assert(Chunk::max_lod <= std::size(lod_distances),
+              "every level of detail needs a distance");
+// how far inside a distance a chunk has to come before it gets finer again
+constexpr static f32 lod_margin = 8.0f;
 
 struct VoxelGame : public core::App {
     VoxelGame(const core::AppConfig &config) : core::App::App(config) {}
 
+    ~VoxelGame() {
+        // stop the workers before the chunks they hold go away
+        workers = nullptr;
+        // free the chunks' GL objects before the context goes away
+        chunks.clear();
+        chunks_cache.clear();
+        Chunk::clear_pools();
+    }
+
     void setup() override {
         util::seed_time();
         // core::assert(false, "this thing works");
@@ -35,6 +62,7 @@ struct VoxelGame : public core::App {
         gfx::set_depth_test(true);
 
         globals->input.mouse.set_relative_mode(true);
+        workers = util::create_uptr<WorkerPool>();
         player = util::create_uptr<Player>(math::vec3(1000.0f, 100.0f, 1000.0f),
                                            math::vec3(1.0f));
         player->set_projection(fov, 1600.0f / 900.0f, near, far);
@@ -45,13 +73,19 @@ struct VoxelGame : public core::App {
             core::ViewportType::fit, 1600, 900);
         viewport->on_resize(window->get_width(), window->get_height());
 
-        // push chunks
+        // push chunks, generated on every core at once
+        std::vector<Chunk *> batch;
         for (i32 z = 0; z < 4; ++z) {
             for (i32 x = 0; x < 4; ++x) {
-                chunks.push_back(
-                    util::create_sptr<Chunk>(math::vec3((f32)x, 0.0f, (f32)z)));
+                chunks.push_back(util::create_sptr<Chunk>(
+                    math::vec3((f32)x, 0.0f, (f32)z), true));
+                batch.push_back(chunks.back().get());
             }
         }
+        Chunk::generate_batch(batch, *workers);
+        for (auto &chunk : chunks) {
+            chunk->update_chunk();
+        }
 
         // water
         water = util::create_uptr<Water>();
@@ -252,11 +286,14 @@ struct VoxelGame : public core::App {
 
             globals->asset_manager.get_texture("block")->bind(0);
             shader->set_uniform_1i("u_texture", 0);
+            shader->set_uniform_1i("u_atlas_size", block_atlas_size);
 
             shader->set_uniform_3f("u_chunk_size", Chunk::dimens);
             for (auto &chunk : chunks) {
                 shader->set_uniform_3f("u_chunk_offset", chunk->get_position());
-                chunk->render(dt);
+                shader->set_uniform_1f("u_lod_scale", chunk->lod_scale());
+                // faces pointing away from the camera are never drawn
+                chunk->render(dt, chunk->faces_toward(player->position));
             }
             shader->unbind();
         });
@@ -297,53 +334,64 @@ struct VoxelGame : public core::App {
         shadow_map_shader->set_uniform_mat4f("u_light_space",
                                              sun->get_view_projection_matrix());
 
+        // only the faces the sun shines on cast shadows
+        const u8 sun_faces = Chunk::faces_along(sun->direction);
         for (auto &chunk : chunks) {
             shadow_map_shader->set_uniform_3f("u_chunk_offset",
                                               chunk->get_position());
-            chunk->render(dt);
+            shadow_map_shader->set_uniform_1f("u_lod_scale",
+                                              chunk->lod_scale());
+            chunk->render(dt, sun_faces);
         }
         shadow_map_shader->unbind();
 
         gfx::FrameBuffer::unbind();
 
+        // the mesh's baked ambient occlusion covers the voxel crevices, SSAO
+        // only adds the finer detail so it can be turned off
+        const bool use_ssao = ssao_samples > 0;
         // render SSAO
-        dfr->quad_pass([&]() {
-            auto ssao_fbo = dfr->framebuffers["ssao"].get();
-            ssao_fbo->bind();
-            gfx::set_clear_color(0.0f, 0.0f, 0.0f, 1.0f);
-            gfx::clear_buffer(OMEGA_GL_COLOR_BUFFER_BIT |
-                              OMEGA_GL_DEPTH_BUFFER_BIT);
-
-            auto ssao_shader = globals->asset_manager.get_shader("ssao");
-            ssao_shader->bind();
-            // bind gbuffer textures
-            dfr->gbuffer->get_attachment("position").bind(0);
-            dfr->gbuffer->get_attachment("normal").bind(1);
-            // bind noise texture
-            globals->asset_manager.get_texture("ssao_noise")->bind(2);
-
-            // set uniforms
-            ssao_shader->set_uniform_1i("u_position", 0);
-            ssao_shader->set_uniform_1i("u_normal", 1);
-            ssao_shader->set_uniform_1i("u_noise", 2);
-
-            ssao_shader->set_uniform_mat4f("u_projection",
-                                           player->get_projection_matrix());
-            ssao_shader->set_uniform_mat4f("u_view", player->get_view_matrix());
-        });
-
-        // blur SSAO
-        dfr->quad_pass([&]() {
-            auto ssao_blur_fbo = dfr->framebuffers["ssao_blur"].get();
-            ssao_blur_fbo->bind();
-            gfx::set_clear_color(0.0f, 0.0f, 0.0f, 1.0f);
-            gfx::clear_buffer(OMEGA_GL_COLOR_BUFFER_BIT |
-                              OMEGA_GL_DEPTH_BUFFER_BIT);
-            auto *shader = globals->asset_manager.get_shader("ssao_blur");
-            // bind ssao texture
-            dfr->framebuffers["ssao"]->get_attachment("ssao").bind(0);
-            shader->set_uniform_1i("u_ssao", 0);
-        });
+        if (use_ssao) {
+            dfr->quad_pass([&]() {
+                auto ssao_fbo = dfr->framebuffers["ssao"].get();
+                ssao_fbo->bind();
+                gfx::set_clear_color(0.0f, 0.0f, 0.0f, 1.0f);
+                gfx::clear_buffer(OMEGA_GL_COLOR_BUFFER_BIT |
+                                  OMEGA_GL_DEPTH_BUFFER_BIT);
+
+                auto ssao_shader = globals->asset_manager.get_shader("ssao");
+                ssao_shader->bind();
+                // bind gbuffer textures
+                dfr->gbuffer->get_attachment("position").bind(0);
+                dfr->gbuffer->get_attachment("normal").bind(1);
+                // bind noise texture
+                globals->asset_manager.get_texture("ssao_noise")->bind(2);
+
+                // set uniforms
+                ssao_shader->set_uniform_1i("u_position", 0);
+                ssao_shader->set_uniform_1i("u_normal", 1);
+                ssao_shader->set_uniform_1i("u_noise", 2);
+                ssao_shader->set_uniform_1i("u_kernel_size", ssao_samples);
+
+                ssao_shader->set_uniform_mat4f(
+                    "u_projection", player->get_projection_matrix());
+                ssao_shader->set_uniform_mat4f("u_view",
+                                               player->get_view_matrix());
+            });
+
+            // blur SSAO
+            dfr->quad_pass([&]() {
+                auto ssao_blur_fbo = dfr->framebuffers["ssao_blur"].get();
+                ssao_blur_fbo->bind();
+                gfx::set_clear_color(0.0f, 0.0f, 0.0f, 1.0f);
+                gfx::clear_buffer(OMEGA_GL_COLOR_BUFFER_BIT |
+                                  OMEGA_GL_DEPTH_BUFFER_BIT);
+                auto *shader = globals->asset_manager.get_shader("ssao_blur");
+                // bind ssao texture
+                dfr->framebuffers["ssao"]->get_attachment("ssao").bind(0);
+                shader->set_uniform_1i("u_ssao", 0);
+            });
+        }
 
         gfx::FrameBuffer::unbind();
 
@@ -378,6 +426,7 @@ struct VoxelGame : public core::App {
             composite_shader->set_uniform_1i("u_color", 2);
             composite_shader->set_uniform_1i("u_depth_map", 3);
             composite_shader->set_uniform_1i("u_ssao", 4);
+            composite_shader->set_uniform_1i("u_ssao_enabled", use_ssao);
             composite_shader->set_uniform_1i("u_water_position", 5);
             composite_shader->set_uniform_1i("u_water_normal", 6);
             composite_shader->set_uniform_1i("u_water_color", 7);
@@ -407,6 +456,44 @@ struct VoxelGame : public core::App {
                     player->position.y,
                     player->position.z);
         ImGui::Text("fps: %f", 1.0f / dt);
+        ImGui::Text("world seed: %u", WorldGen::instance()->get_seed());
+        ImGui::Text("cached chunks: %zu (%zu compressed, %.1f KB)",
+                    chunks_cache.size(),
+                    chunks_cache.size() - chunks.size(),
+                    cache_compressed_bytes / 1024.0f);
+        ImGui::Text("unedited chunks dropped: %zu", chunks_dropped);
+        auto pools = Chunk::pool_stats();
+        ImGui::Text("pooled: %zu sections, %zu meshes, %zu quad buffers",
+                    pools.sections,
+                    pools.meshes,
+                    pools.quad_buffers);
+        size_t quads = 0, mesh_bytes = 0;
+        for (const auto &chunk : chunks) {
+            quads += chunk->quad_count();
+            mesh_bytes += chunk->mesh_bytes();
+        }
+        ImGui::Text("chunk quads: %zu (%.1f KB)",
+                    quads,
+                    quads * sizeof(Quad) / 1024.0f);
+        // meshes used to be mirrored in system memory for remeshing
+        ImGui::Text("mesh RAM saved: %.1f KB (GPU only)",
+                    mesh_bytes / 1024.0f);
+        bool greedy = Chunk::mesh_mode == MeshMode::greedy;
+        if (ImGui::Checkbox("greedy meshing", &greedy)) {
+            Chunk::mesh_mode = greedy ? MeshMode::greedy : MeshMode::naive;
+            for (auto &chunk : chunks) {
+                if (!in_flight.contains(chunk->get_position())) {
+                    build_async(chunk);
+                }
+            }
+        }
+        ImGui::Text("meshing: %zu in flight, %zu jobs queued",
+                    in_flight.size(),
+                    workers->pending());
+        ImGui::SliderInt("SSAO samples (0 = off)",
+                         &ssao_samples,
+                         0,
+                         (i32)max_ssao_samples);
         ImGui::End();
     }
 
@@ -486,24 +573,56 @@ struct VoxelGame : public core::App {
             chunk_load_time = 0.0f;
             chunks_loaded = 0;
             for (const auto &position : possible_to_add) {
-                // check if already placed
-                if (current_chunks_map[position] == chunk_active) continue;
+                // check if already placed or on its way
+                const u8 state = current_chunks_map[position];
+                if (state == chunk_active || state == chunk_loading) continue;
                 // otherwise add it
                 f32 before = util::time::get_time<f32>();
                 add_chunk(position.x, position.y, position.z);
                 chunk_load_time += util::time::get_time<f32>() - before;
                 ++chunks_loaded;
             }
+            generate_new_chunks();
             // remove chunks that are not in the possible_to_add set
             for (int i = chunks.size() - 1; i >= 0; --i) {
                 const auto &chunk = chunks[i];
                 const auto &pos = chunk->get_position();
                 if (possible_to_add.find(pos) == possible_to_add.end()) {
                     current_chunks_map[pos] = 0;
+                    // the neighbours' sides facing it are now open
+                    unlink_neighbors(*chunk);
+                    // a worker still has it, it's put away once it's done
+                    if (!in_flight.contains(pos)) unload_chunk(*chunk);
                     chunks.erase(chunks.begin() + i);
                 }
             }
+            // chunks still being built that went out of view
+            for (const auto &pos : in_flight) {
+                if (possible_to_add.find(pos) == possible_to_add.end()) {
+                    current_chunks_map[pos] = 0;
+                }
+            }
+        }
+        upload_built_chunks();
+        // hand edited borders to the neighbours, then remesh the parts of
+        // every chunk that changed this frame
+        // chunks a worker is building are left alone until it's done
+        for (auto &chunk : chunks) {
+            if (in_flight.contains(chunk->get_position())) continue;
+            if (chunk->take_border_edit()) link_neighbors(*chunk);
+        }
+        for (auto &chunk : chunks) {
+            if (in_flight.contains(chunk->get_position())) continue;
+            // a new level of detail dirties the whole chunk
+            chunk->set_lod(lod_level(*chunk));
+            if (chunk->needs_rebuild()) {
+                // the old mesh keeps drawing until the new one is uploaded
+                build_async(chunk);
+            } else if (chunk->needs_remesh()) {
+                chunk->remesh_dirty();
+            }
         }
+
         // update the camera last position
         // round to the nearest n voxels to avoid updating too frequently
         cam_last_position = math::round(player->position / voxels) * voxels;
@@ -516,21 +635,254 @@ struct VoxelGame : public core::App {
     }
 
     void add_chunk(i32 x, i32 y, i32 z) {
-        // check if it already exists in the chunks cache
-        // if so add it to the chunk vector and add to the current chunks
-        // map
         math::vec3 position(x, y, z);
-        bool exists = chunks_cache[position] != nullptr;
-        if (exists) {
-            chunks.push_back(chunks_cache[position]);
-            current_chunks_map[position] = chunk_active;
+        current_chunks_map[position] = chunk_loading;
+        // still being built, it goes back in view once it's uploaded
+        if (in_flight.contains(position)) return;
+        // check if it already exists in the chunks cache, otherwise create a
+        // new chunk
+        auto &chunk = chunks_cache[position];
+        if (chunk != nullptr) {
+            cache_compressed_bytes -= chunk->compressed_size();
+            build_async(chunk);
+            return;
+        }
+        chunk = util::create_sptr<Chunk>(position, true);
+        // generated along with the other new chunks around it
+        new_chunks.push_back(chunk);
+    }
+
+    /**
+     * Hands the chunks add_chunk() created to the workers, grouped into
+     * regions of region_size^2 chunks that share one noise sampling
+     */
+    void generate_new_chunks() {
+        std::unordered_map<math::vec3, std::vector<util::sptr<Chunk>>> regions;
+        for (auto &chunk : new_chunks) {
+            const math::vec3 region =
+                math::floor(chunk->get_position() / (f32)region_size);
+            regions[region].push_back(std::move(chunk));
+        }
+        new_chunks.clear();
+        for (auto &[region, group] : regions) {
+            build_region_async(std::move(group));
+        }
+    }
+
+    // a region's chunks on their way through the workers
+    struct RegionBuild {
+        WorldGen::Region region;
+        std::vector<util::sptr<Chunk>> chunks;
+        // chunks still being generated
+        std::atomic<u32> generating = 0;
+    };
+
+    /**
+     * build_async() for new chunks sharing a region, one job samples the
+     * region's noise and hands every chunk to a job that generates it
+     * The last one generated gives the chunks the borders they share and
+     * hands each to a job that meshes and publishes it
+     */
+    void build_region_async(std::vector<util::sptr<Chunk>> chunks) {
+        for (const auto &chunk : chunks) {
+            in_flight.insert(chunk->get_position());
+        }
+        for (const auto &chunk : chunks) {
+            chunk->set_lod(lod_level(*chunk));
+            take_borders(*chunk);
+        }
+        auto build = util::create_sptr<RegionBuild>();
+        build->generating = chunks.size();
+        build->chunks = std::move(chunks);
+        // workers is already null while the pool finishes its last jobs
+        WorkerPool *pool = workers.get();
+        pool->submit([this, pool, build]() {
+            Chunk::sample_region(region_members(*build), build->region);
+            for (auto &chunk : build->chunks) {
+                pool->submit([this, pool, build, chunk = chunk.get()]() {
+                    chunk->generate(build->region);
+                    chunk->decompress();
+                    if (--build->generating == 0) mesh_region(pool, build);
+                });
+            }
+        });
+    }
+
+    void mesh_region(WorkerPool *pool, const util::sptr<RegionBuild> &build) {
+        Chunk::link_region(region_members(*build));
+        for (auto &chunk : build->chunks) {
+            pool->submit([this, &chunk, build]() {
+                chunk->build_mesh();
+                // hand the reference over so the job never holds the last
+                // one
+                std::lock_guard<std::mutex> lock(built_mutex);
+                built.push_back(std::move(chunk));
+            });
+        }
+    }
+
+    static std::vector<Chunk *> region_members(const RegionBuild &build) {
+        std::vector<Chunk *> members;
+        for (const auto &chunk : build.chunks) {
+            members.push_back(chunk.get());
+        }
+        return members;
+    }
+
+    /**
+     * Unpacks and meshes the chunk on a worker thread, upload_built_chunks()
+     * picks it up when it's done
+     * Until then the main thread mustn't edit the chunk or its borders
+     */
+    void build_async(const util::sptr<Chunk> &chunk) {
+        in_flight.insert(chunk->get_position());
+        chunk->set_lod(lod_level(*chunk));
+        take_borders(*chunk);
+        workers->submit([this, chunk]() mutable {
+            chunk->decompress();
+            chunk->build_mesh();
+            // hand the reference over so the job never holds the last one,
+            // chunks have to be destroyed on the main thread
+            std::lock_guard<std::mutex> lock(built_mutex);
+            built.push_back(std::move(chunk));
+        });
+    }
+
+    // uploads a few of the chunks the workers finished, the rest wait for
+    // the next frames so a burst of them doesn't stall one frame
+    void upload_built_chunks() {
+        std::vector<util::sptr<Chunk>> ready;
+        {
+            std::lock_guard<std::mutex> lock(built_mutex);
+            while (!built.empty() && ready.size() < uploads_per_frame) {
+                ready.push_back(std::move(built.front()));
+                built.pop_front();
+            }
+        }
+        for (auto &chunk : ready) {
+            const math::vec3 &pos = chunk->get_position();
+            in_flight.erase(pos);
+            u8 &state = current_chunks_map[pos];
+            if (state == 0) {
+                // went out of view while it was being built, the chunks
+                // built along with it took its border
+                unlink_neighbors(*chunk);
+                unload_chunk(*chunk);
+                continue;
+            }
+            chunk->upload_mesh();
+            if (state != chunk_active) {
+                state = chunk_active;
+                chunks.push_back(chunk);
+            }
+            // swap borders with the neighbours now that it can be read,
+            // whoever's border changed gets meshed again
+            link_neighbors(*chunk);
+        }
+    }
+
+    // only keep the packed blocks while out of view, a chunk nobody edited
+    // is dropped instead and generated again from the seed if it comes back
+    void unload_chunk(Chunk &chunk) {
+        if (!chunk.is_edited()) {
+            ++chunks_dropped;
+            // free the GL objects here, whoever holds the last reference
+            chunk.release_mesh();
+            chunks_cache.erase(chunk.get_position());
             return;
         }
-        // otherwise create a new chunk
-        auto chunk = util::create_sptr<Chunk>(position);
-        chunks.push_back(chunk);
-        chunks_cache[position] = *chunks.rbegin();
-        current_chunks_map[position] = chunk_active;
+        chunk.compress();
+        chunk.release_mesh();
+        cache_compressed_bytes += chunk.compressed_size();
+    }
+
+    /**
+     * Level of detail for the chunk's horizontal distance to the player
+     * A coarse chunk keeps its level until it's lod_margin past the distance
+     * so walking back and forth across it doesn't rebuild it every time
+     */
+    u32 lod_level(const Chunk &chunk) const {
+        const math::vec3 center =
+            (chunk.get_position() + math::vec3(0.5f)) * Chunk::dimens;
+        const f32 distance = math::length(math::vec2(
+            center.x - player->position.x, center.z - player->position.z));
+        u32 level = 0;
+        while (level < Chunk::max_lod && distance > lod_distances[level]) {
+            ++level;
+        }
+        const u32 current = chunk.get_lod();
+        if (level < current &&
+            distance > lod_distances[current - 1] - lod_margin) {
+            return current;
+        }
+        return level;
+    }
+
+    // the chunk at position if it's loaded and can be read
+    Chunk *active_chunk(const math::vec3 &position) {
+        auto it = current_chunks_map.find(position);
+        if (it == current_chunks_map.end() || it->second != chunk_active) {
+            return nullptr;
+        }
+        return chunks_cache[position].get();
+    }
+
+    static math::vec3 neighbor_position(const math::vec3 &position,
+                                        Direction side) {
+        // ordered the same as Direction
+        const math::vec3 offsets[4] = {math::vec3(-1.0f, 0.0f, 0.0f),
+                                       math::vec3(1.0f, 0.0f, 0.0f),
+                                       math::vec3(0.0f, 0.0f, 1.0f),
+                                       math::vec3(0.0f, 0.0f, -1.0f)};
+        return position + offsets[(u8)side];
+    }
+
+    // the loaded chunk next to position on side, nullptr if there isn't one
+    Chunk *active_neighbor(const math::vec3 &position, Direction side) {
+        return active_chunk(neighbor_position(position, side));
+    }
+
+    /**
+     * Gives the chunk the borders of its loaded neighbours, called before
+     * it's meshed so the mesh doesn't wall off their sides
+     * A neighbour a worker is still building keeps the border it already
+     * gave the chunk, it's swapped again once that one is done
+     */
+    void take_borders(Chunk &chunk) {
+        for (u8 i = 0; i < 4; ++i) {
+            const Direction side = (Direction)i;
+            const math::vec3 position =
+                neighbor_position(chunk.get_position(), side);
+            Chunk *neighbor = active_chunk(position);
+            if (neighbor == nullptr && in_flight.contains(position)) continue;
+            chunk.set_neighbor(side, neighbor);
+        }
+    }
+
+    // swaps borders between the chunk and its loaded neighbours, neighbours
+    // a worker is building pick up the border once they're done
+    void link_neighbors(Chunk &chunk) {
+        take_borders(chunk);
+        for (u8 i = 0; i < 4; ++i) {
+            Chunk *neighbor =
+                active_neighbor(chunk.get_position(), (Direction)i);
+            if (neighbor != nullptr &&
+                !in_flight.contains(neighbor->get_position())) {
+                // left <-> right, forward <-> backward
+                neighbor->set_neighbor((Direction)(i ^ 1), &chunk);
+            }
+        }
+    }
+
+    void unlink_neighbors(Chunk &chunk) {
+        for (u8 i = 0; i < 4; ++i) {
+            Chunk *neighbor =
+                active_neighbor(chunk.get_position(), (Direction)i);
+            if (neighbor != nullptr &&
+                !in_flight.contains(neighbor->get_position())) {
+                neighbor->set_neighbor((Direction)(i ^ 1), nullptr);
+            }
+        }
     }
 
     void input(f32 dt) override {
@@ -558,7 +910,7 @@ struct VoxelGame : public core::App {
         else if (right)
             move = r;
         // we're not adding 3D movement
-        player->move(dt, -30.0f, move, chunks_cache[math::vec3(0.0f)].get());
+        player->move(dt, -30.0f, move, active_chunk(math::vec3(0.0f)));
 
         // jump
         if (keys.key_just_pressed(events::Key::k_space)) {
@@ -581,8 +933,16 @@ struct VoxelGame : public core::App {
 
     // chunk data
     static constexpr u8 chunk_active = 95;
+    // waiting on a worker to build it
+    static constexpr u8 chunk_loading = 96;
+    // finished chunks uploaded to the GPU per frame
+    static constexpr u32 uploads_per_frame = 4;
+    // new chunks are generated in blocks of up to region_size^2
+    static constexpr u32 region_size = 4;
     f32 chunk_load_time = 0.0f;
     u32 chunks_loaded = 0;
+    size_t cache_compressed_bytes = 0;
+    size_t chunks_dropped = 0;
 
     // map of taken chunks for constant search time
     std::unordered_map<math::vec3, u8> current_chunks_map;
@@ -590,6 +950,16 @@ struct VoxelGame : public core::App {
     // map of all chunks ever loaded
     std::unordered_map<math::vec3, util::sptr<Chunk>> chunks_cache;
 
+    // generates and meshes chunks off the main thread
+    util::uptr<WorkerPool> workers = nullptr;
+    // chunks a worker is building
+    std::unordered_set<math::vec3> in_flight;
+    // chunks the workers finished, waiting to be uploaded
+    std::mutex built_mutex;
+    std::deque<util::sptr<Chunk>> built;
+    // created by add_chunk() this frame, see generate_new_chunks()
+    std::vector<util::sptr<Chunk>> new_chunks;
+
     // entities
     util::uptr<Player> player = nullptr;
     util::uptr<Sun> sun = nullptr;
@@ -600,6 +970,9 @@ struct VoxelGame : public core::App {
     util::uptr<gfx::renderer::DeferredRenderer> dfr = nullptr;
     util::uptr<gfx::renderer::DeferredRenderer> water_dfr = nullptr;
     util::uptr<gfx::FrameBuffer> shadow_map = nullptr;
+    // samples per pixel of the SSAO pass, 0 skips it, see ssao.glsl
+    static constexpr u32 max_ssao_samples = 64;
+    i32 ssao_samples = 32;
 };
 
 int main() {